@@ -0,0 +1,127 @@
+/**
+ * @brief Lequel? heap allocation counting
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ *
+ * @cite https://sourceware.org/glibc/wiki/MallocInternals
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationTracking.h"
+
+using namespace std;
+
+// Heap use of the whole process, from all threads
+static atomic<uint64_t> allocationNum(0);
+static atomic<uint64_t> allocatedBytes(0);
+static atomic<int64_t> currentBytes(0);
+static atomic<int64_t> baseBytes(0);
+static atomic<int64_t> peakBytes(0);
+
+#ifdef LEQUEL_ALLOCATION_TRACKING
+
+// Prefix of each block allocated through operator new: the requested size,
+// padded so the returned memory keeps malloc's alignment
+const size_t ALLOCATION_HEADER_SIZE = alignof(max_align_t);
+
+// Accounting allocator hook, only built with LEQUEL_ALLOCATION_TRACKING: the
+// global operator new and delete, replaced for the whole program. Aligned
+// and nothrow forms that are not replaced keep the standard allocator, and
+// are not counted.
+
+void *operator new(size_t size)
+{
+    void *block = malloc(ALLOCATION_HEADER_SIZE + size);
+    if (!block)
+        throw bad_alloc();
+    *(size_t *)block = size;
+
+    allocationNum.fetch_add(1, memory_order_relaxed);
+    allocatedBytes.fetch_add(size, memory_order_relaxed);
+    int64_t bytes = currentBytes.fetch_add(size, memory_order_relaxed) + size;
+    int64_t peak = peakBytes.load(memory_order_relaxed);
+    while ((bytes > peak) && !peakBytes.compare_exchange_weak(peak, bytes, memory_order_relaxed))
+        ;
+
+    return (char *)block + ALLOCATION_HEADER_SIZE;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    if (!p)
+        return;
+
+    void *block = (char *)p - ALLOCATION_HEADER_SIZE;
+    currentBytes.fetch_sub(*(size_t *)block, memory_order_relaxed);
+    free(block);
+}
+
+void operator delete[](void *p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+#endif
+
+/**
+ * @brief Whether allocations are counted (built with
+ * LEQUEL_ALLOCATION_TRACKING).
+ */
+bool isAllocationTrackingEnabled()
+{
+#ifdef LEQUEL_ALLOCATION_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Starts measuring the heap use of the process, as for a request.
+ * Allocations of concurrent requests are counted together.
+ */
+void startAllocationTracking()
+{
+    allocationNum.store(0, memory_order_relaxed);
+    allocatedBytes.store(0, memory_order_relaxed);
+    int64_t bytes = currentBytes.load(memory_order_relaxed);
+    baseBytes.store(bytes, memory_order_relaxed);
+    peakBytes.store(bytes, memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the heap use of the process since startAllocationTracking().
+ */
+AllocationStats getAllocationStats()
+{
+    int64_t base = baseBytes.load(memory_order_relaxed);
+    int64_t peak = peakBytes.load(memory_order_relaxed);
+
+    AllocationStats stats;
+    stats.allocationNum = allocationNum.load(memory_order_relaxed);
+    stats.allocatedBytes = allocatedBytes.load(memory_order_relaxed);
+    stats.heldBytes = currentBytes.load(memory_order_relaxed) - base;
+    stats.peakBytes = peak > base ? peak - base : 0;
+
+    return stats;
+}
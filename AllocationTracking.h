@@ -0,0 +1,29 @@
+/**
+ * @brief Lequel? heap allocation counting
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef ALLOCATIONTRACKING_H
+#define ALLOCATIONTRACKING_H
+
+#include <cstdint>
+
+// AllocationStats: heap use of the process since startAllocationTracking().
+// heldBytes and peakBytes are the memory held now and at most, above what
+// was held when tracking started.
+struct AllocationStats
+{
+    uint64_t allocationNum;
+    uint64_t allocatedBytes;
+    int64_t heldBytes;
+    uint64_t peakBytes;
+};
+
+// Functions
+bool isAllocationTrackingEnabled();
+void startAllocationTracking();
+AllocationStats getAllocationStats();
+
+#endif
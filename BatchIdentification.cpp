@@ -0,0 +1,133 @@
+/**
+ * @brief Lequel? parallel identification of many files
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include <stdexcept>
+
+#include "BatchIdentification.h"
+
+using namespace std;
+
+/**
+ * @brief Creates an empty batch.
+ *
+ * @param model The language model (must outlive this object)
+ * @param threadPool Thread pool that runs the jobs (must outlive this object)
+ */
+BatchIdentification::BatchIdentification(const LanguageModel &model, ThreadPool &threadPool) : model(model),
+                                                                                              threadPool(threadPool),
+                                                                                              batch(make_shared<Batch>())
+{
+}
+
+/**
+ * @brief Cancels the pending jobs.
+ */
+BatchIdentification::~BatchIdentification()
+{
+    clear();
+}
+
+/**
+ * @brief Queues one job per file, replacing the current batch.
+ *
+ * @param paths Paths of the files to identify
+ */
+void BatchIdentification::identifyFiles(const vector<string> &paths)
+{
+    clear();
+
+    for (auto &path : paths)
+    {
+        batch->entries.push_back(unique_ptr<Entry>(new Entry()));
+        batch->entries.back()->path = path;
+    }
+
+    // Jobs keep the batch alive if it is replaced while they run
+    shared_ptr<Batch> jobBatch = batch;
+    const LanguageModel &jobModel = model;
+    for (auto &entry : batch->entries)
+    {
+        Entry *jobEntry = entry.get();
+        threadPool.submit([jobBatch, jobEntry, &jobModel]()
+                          {
+            if (jobEntry->progress.cancelled)
+                return;
+
+            string languageCode;
+            try
+            {
+                Text text;
+                if (getTextFromFile(jobEntry->path, text))
+                    languageCode = identifyLanguage(text, jobModel, &jobEntry->progress);
+            }
+            catch (const exception &)
+            {
+                // Not UTF-8 text (e.g. a binary file)
+                languageCode.clear();
+            }
+
+            jobEntry->languageCode = languageCode;
+            jobEntry->done.store(true, memory_order_release);
+            jobBatch->finishedNum.fetch_add(1, memory_order_relaxed); });
+    }
+}
+
+/**
+ * @brief Cancels the current batch and empties the result list.
+ */
+void BatchIdentification::clear()
+{
+    for (auto &entry : batch->entries)
+        entry->progress.cancelled = true;
+
+    batch = make_shared<Batch>();
+}
+
+/**
+ * @brief Number of files in the batch.
+ */
+size_t BatchIdentification::size() const
+{
+    return batch->entries.size();
+}
+
+/**
+ * @brief Number of files already identified.
+ */
+size_t BatchIdentification::getFinishedNum() const
+{
+    return batch->finishedNum.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Path of a file in the batch.
+ *
+ * @param index Index of the file
+ */
+const string &BatchIdentification::getPath(size_t index) const
+{
+    return batch->entries[index]->path;
+}
+
+/**
+ * @brief Fetches the result for a file, if it was identified.
+ *
+ * @param index Index of the file
+ * @param languageCode Destination language code
+ * @return true The file was identified
+ * @return false The file is still queued or being identified
+ */
+bool BatchIdentification::getResult(size_t index, string &languageCode) const
+{
+    Entry &entry = *batch->entries[index];
+    if (!entry.done.load(memory_order_acquire))
+        return false;
+
+    languageCode = entry.languageCode;
+
+    return true;
+}
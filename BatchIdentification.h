@@ -0,0 +1,56 @@
+/**
+ * @brief Lequel? parallel identification of many files
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef BATCHIDENTIFICATION_H
+#define BATCHIDENTIFICATION_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "LanguageModel.h"
+#include "ThreadPool.h"
+
+// BatchIdentification: identifies a list of files on a thread pool. Results
+// fill in as workers finish; the UI thread reads them without locking.
+class BatchIdentification
+{
+public:
+    BatchIdentification(const LanguageModel &model, ThreadPool &threadPool);
+    ~BatchIdentification();
+
+    void identifyFiles(const std::vector<std::string> &paths);
+    void clear();
+
+    size_t size() const;
+    size_t getFinishedNum() const;
+    const std::string &getPath(size_t index) const;
+    bool getResult(size_t index, std::string &languageCode) const;
+
+private:
+    struct Entry
+    {
+        std::string path;
+        IdentificationProgress progress;
+        std::string languageCode;
+        std::atomic<bool> done{false};
+    };
+
+    struct Batch
+    {
+        std::vector<std::unique_ptr<Entry>> entries;
+        std::atomic<size_t> finishedNum{0};
+    };
+
+    const LanguageModel &model;
+    ThreadPool &threadPool;
+
+    std::shared_ptr<Batch> batch;
+};
+
+#endif
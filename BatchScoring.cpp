@@ -0,0 +1,111 @@
+/**
+ * @brief Lequel? batched scoring of many short documents
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include <algorithm>
+
+#include "BatchScoring.h"
+#include "SimdKernels.h"
+#include "Tracing.h"
+
+using namespace std;
+
+/**
+ * @brief Identifies the language of many documents at once.
+ *
+ * @param documents The documents, as '\n'-separated strings
+ * @param model The language model
+ * @param languageCodes Destination language codes, one per document
+ */
+void identifyLanguages(const vector<string> &documents, const LanguageModel &model,
+                       vector<string> &languageCodes)
+{
+    vector<TrigramIdProfile> textProfiles(documents.size());
+    for (size_t i = 0; i < documents.size(); i++)
+    {
+        Text text;
+        getTextFromString(documents[i], text);
+        buildTrigramIdProfile(text, model.vocabulary, textProfiles[i]);
+    }
+
+    identifyLanguages(textProfiles, model, languageCodes);
+}
+
+/**
+ * @brief Identifies the language of many normalized text id profiles at once.
+ *
+ * The profiles form a sparse document x trigram matrix, which multiplies the
+ * dense trigram x language model in tiles: documents are split into tiles
+ * whose scores fit in BATCH_TILE_BYTES, and trigram ids into ranges whose
+ * model rows fit in BATCH_ROW_TILE_BYTES. A tile's documents are scored one
+ * row range at a time, so each model row is read from memory once per tile
+ * and serves every document of the tile that has the trigram. Profiles are
+ * sorted by id, so a cursor per document walks the ranges without sorting.
+ * Each document's scores add up in the same order as in identifyLanguage(),
+ * so the results match.
+ *
+ * @param textProfiles The normalized text trigram profiles
+ * @param model The language model
+ * @param languageCodes Destination language codes, one per profile
+ */
+void identifyLanguages(const vector<TrigramIdProfile> &textProfiles, const LanguageModel &model,
+                       vector<string> &languageCodes)
+{
+    TraceSpan span("score (batch)");
+
+    languageCodes.assign(textProfiles.size(), "");
+    if (model.languageCodes.empty())
+        return;
+
+    size_t rowBytes = model.rowSize * sizeof(float);
+    size_t tileSize = max(BATCH_TILE_BYTES / rowBytes, (size_t)1);
+    size_t rangeSize = max(BATCH_ROW_TILE_BYTES / rowBytes, (size_t)1);
+    size_t trigramNum = model.vocabulary.size();
+
+    vector<size_t> cursors;
+    vector<float> scores;
+    for (size_t tileBegin = 0; tileBegin < textProfiles.size(); tileBegin += tileSize)
+    {
+        size_t tileEnd = min(tileBegin + tileSize, textProfiles.size());
+
+        cursors.assign(tileEnd - tileBegin, 0);
+        scores.assign((tileEnd - tileBegin) * model.rowSize, 0.0f);
+
+        for (size_t rangeEnd = rangeSize;; rangeEnd += rangeSize)
+        {
+            for (size_t i = tileBegin; i < tileEnd; i++)
+            {
+                const TrigramIdProfile &textProfile = textProfiles[i];
+                float *documentScores = &scores[(i - tileBegin) * model.rowSize];
+
+                size_t &cursor = cursors[i - tileBegin];
+                for (; (cursor < textProfile.size()) && (textProfile[cursor].first < rangeEnd); cursor++)
+                {
+                    accumulateRow(model.getRow(textProfile[cursor].first), textProfile[cursor].second,
+                                  documentScores, model.rowSize);
+                }
+            }
+
+            if (rangeEnd >= trigramNum)
+                break;
+        }
+
+        for (size_t i = tileBegin; i < tileEnd; i++)
+        {
+            const float *documentScores = &scores[(i - tileBegin) * model.rowSize];
+
+            float max = 0.0f;
+            for (size_t j = 0; j < model.languageCodes.size(); j++)
+            {
+                if (documentScores[j] > max)
+                {
+                    max = documentScores[j];
+                    languageCodes[i] = model.languageCodes[j];
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,27 @@
+/**
+ * @brief Lequel? batched scoring of many short documents
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef BATCHSCORING_H
+#define BATCHSCORING_H
+
+#include <string>
+#include <vector>
+
+#include "LanguageModel.h"
+
+// Tile sizes of batched scoring: bytes of document scores, and bytes of
+// model rows, scored together (both fit in an L2 cache)
+const size_t BATCH_TILE_BYTES = 256 * 1024;
+const size_t BATCH_ROW_TILE_BYTES = 1024 * 1024;
+
+// Functions
+void identifyLanguages(const std::vector<std::string> &documents, const LanguageModel &model,
+                       std::vector<std::string> &languageCodes);
+void identifyLanguages(const std::vector<TrigramIdProfile> &textProfiles, const LanguageModel &model,
+                       std::vector<std::string> &languageCodes);
+
+#endif
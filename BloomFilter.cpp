@@ -0,0 +1,82 @@
+/**
+ * @brief Lequel? split-block Bloom filter
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ *
+ * @cite https://github.com/apache/parquet-format/blob/master/BloomFilter.md
+ */
+
+#include "BloomFilter.h"
+
+// Odd constants that pick one bit per block word
+static const uint32_t BLOOM_SALTS[8] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+/**
+ * @brief Allocates an empty filter.
+ *
+ * @param elementNum Expected number of elements
+ * @param bitsPerElement Filter bits per element (8 gives about 2% false positives)
+ */
+void BloomFilter::build(size_t elementNum, size_t bitsPerElement)
+{
+    size_t blockNum = (elementNum * bitsPerElement + 255) / 256;
+    if (!blockNum)
+        blockNum = 1;
+
+    blocks.assign(blockNum, Block());
+}
+
+/**
+ * @brief Adds an element.
+ *
+ * @param hash The element's 64-bit hash
+ */
+void BloomFilter::insert(uint64_t hash)
+{
+    Block &block = blocks[getBlockIndex(hash)];
+    uint32_t key = (uint32_t)hash;
+    for (int i = 0; i < 8; i++)
+        block.words[i] |= 1U << ((key * BLOOM_SALTS[i]) >> 27);
+}
+
+/**
+ * @brief Checks whether an element may be in the set.
+ *
+ * @param hash The element's 64-bit hash
+ * @return true The element may be in the set
+ * @return false The element is definitely not in the set
+ */
+bool BloomFilter::mightContain(uint64_t hash) const
+{
+    if (blocks.empty())
+        return true;
+
+    const Block &block = blocks[getBlockIndex(hash)];
+    uint32_t key = (uint32_t)hash;
+    for (int i = 0; i < 8; i++)
+    {
+        if (!(block.words[i] & (1U << ((key * BLOOM_SALTS[i]) >> 27))))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Size of the filter bits, in bytes.
+ */
+size_t BloomFilter::getByteSize() const
+{
+    return blocks.size() * sizeof(Block);
+}
+
+/**
+ * @brief Maps the upper half of the hash to a block, without a division.
+ */
+size_t BloomFilter::getBlockIndex(uint64_t hash) const
+{
+    return (size_t)(((hash >> 32) * blocks.size()) >> 32);
+}
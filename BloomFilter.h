@@ -0,0 +1,40 @@
+/**
+ * @brief Lequel? split-block Bloom filter
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ *
+ * @cite https://github.com/apache/parquet-format/blob/master/BloomFilter.md
+ */
+
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// BloomFilter: approximate set membership of 64-bit hashes. Each element sets
+// 8 bits within a single 32-byte block, so a query touches one cache line.
+// An empty (unbuilt) filter answers "maybe" to every query.
+class BloomFilter
+{
+public:
+    void build(size_t elementNum, size_t bitsPerElement = 8);
+    void insert(uint64_t hash);
+    bool mightContain(uint64_t hash) const;
+
+    size_t getByteSize() const;
+
+private:
+    struct Block
+    {
+        uint32_t words[8];
+    };
+
+    size_t getBlockIndex(uint64_t hash) const;
+
+    std::vector<Block> blocks;
+};
+
+#endif
@@ -0,0 +1,351 @@
+/**
+ * @brief Lequel? byte-level trigram model (no Unicode decoding)
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+
+#include "ByteTrigramModel.h"
+#include "CSVData.h"
+#include "SimdKernels.h"
+
+using namespace std;
+
+const uint32_t NO_BYTE_TRIGRAM = 0xffffffff;
+
+/**
+ * @brief Lowercases an ASCII letter byte. Other bytes, including those of
+ * non-ASCII letters, are left as they are, since folding them would need
+ * decoding.
+ */
+static inline uint32_t foldByteCase(unsigned char c)
+{
+    return ((unsigned)(c - 'A') < 26) ? c + ('a' - 'A') : c;
+}
+
+/**
+ * @brief Calls f(trigram) for every byte trigram of a line.
+ *
+ * ASCII letters are lowercased, as the code point profiles the byte
+ * profiles derive from are case folded. Byte trigrams do not include the
+ * line's trailing '\r'.
+ */
+template <typename Function>
+static inline void forEachByteTrigram(const string &line, Function f)
+{
+    size_t size = line.size();
+    if (size && (line[size - 1] == '\r'))
+        size--;
+
+    const unsigned char *data = (const unsigned char *)line.data();
+    if (size < 3)
+        return;
+
+    uint32_t trigram = (foldByteCase(data[0]) << 8) | foldByteCase(data[1]);
+    for (size_t i = 2; i < size; i++)
+    {
+        trigram = ((trigram << 8) | foldByteCase(data[i])) & 0xffffff;
+        f(trigram);
+    }
+}
+
+/**
+ * @brief Slot of a byte trigram in the open-addressing table.
+ */
+static inline size_t getByteTrigramSlot(uint32_t trigram, size_t slotMask)
+{
+    return (size_t)((trigram * 0x9e3779b1U) >> 8) & slotMask;
+}
+
+/**
+ * @brief Finds the row id of a byte trigram.
+ *
+ * @param trigram The packed byte trigram
+ * @return uint32_t The row id, or NO_BYTE_TRIGRAM if not in the model
+ */
+uint32_t ByteTrigramModel::findTrigram(uint32_t trigram) const
+{
+    size_t slotMask = slotTrigrams.size() - 1;
+    for (size_t slot = getByteTrigramSlot(trigram, slotMask);; slot = (slot + 1) & slotMask)
+    {
+        if (slotTrigrams[slot] == trigram)
+            return slotIds[slot];
+        if (slotTrigrams[slot] == NO_BYTE_TRIGRAM)
+            return NO_BYTE_TRIGRAM;
+    }
+}
+
+/**
+ * @brief Builds a byte trigram profile from a given text.
+ *
+ * @param text Vector of lines (Text)
+ * @param byteProfile Destination profile (counts are added)
+ */
+void buildByteTrigramProfile(const Text &text, ByteTrigramProfile &byteProfile)
+{
+    for (auto &line : text)
+        forEachByteTrigram(line, [&byteProfile](uint32_t trigram)
+                           { byteProfile[trigram] += 1.0f; });
+}
+
+/**
+ * @brief Derives a byte trigram profile from a code point trigram profile.
+ *
+ * Each trigram adds its frequency to the byte trigrams of its UTF-8
+ * encoding. Every byte trigram of a text lies within some code point
+ * trigram, so this approximates the byte trigram counts of the text the
+ * profile came from.
+ *
+ * @param trigramProfile The trigram profile
+ * @param byteProfile Destination profile
+ */
+void deriveByteTrigramProfile(const TrigramProfile &trigramProfile, ByteTrigramProfile &byteProfile)
+{
+    for (auto &entry : trigramProfile)
+    {
+        float frequency = entry.second;
+        forEachByteTrigram(entry.first, [&byteProfile, frequency](uint32_t trigram)
+                           { byteProfile[trigram] += frequency; });
+    }
+}
+
+/**
+ * @brief Trains a byte trigram profile from a corpus.
+ *
+ * @param corpus The corpus
+ * @param maxTrigramNum Maximum number of byte trigrams to keep (most frequent)
+ * @param byteProfile Destination profile, as raw counts
+ */
+void trainByteTrigramProfile(const Text &corpus, size_t maxTrigramNum, ByteTrigramProfile &byteProfile)
+{
+    ByteTrigramProfile counts;
+    buildByteTrigramProfile(corpus, counts);
+
+    vector<pair<float, uint32_t>> sortedCounts;
+    for (auto &entry : counts)
+        sortedCounts.push_back(make_pair(entry.second, entry.first));
+
+    size_t keptNum = min(maxTrigramNum, sortedCounts.size());
+    partial_sort(sortedCounts.begin(), sortedCounts.begin() + keptNum, sortedCounts.end(),
+                 [](const pair<float, uint32_t> &a, const pair<float, uint32_t> &b)
+                 { return (a.first > b.first) || ((a.first == b.first) && (a.second < b.second)); });
+
+    byteProfile.clear();
+    for (size_t i = 0; i < keptNum; i++)
+        byteProfile[sortedCounts[i].second] = sortedCounts[i].first;
+}
+
+/**
+ * @brief Reads a byte trigram profile from a CSV file of (hex trigram, count) rows.
+ *
+ * Byte trigrams are stored as 6 hex digits, since they need not be valid UTF-8.
+ *
+ * @param path The filename
+ * @param byteProfile Destination profile (not normalized)
+ * @return true Succeeded
+ * @return false Failed
+ */
+bool readByteTrigramProfile(const string &path, ByteTrigramProfile &byteProfile)
+{
+    CSVData data;
+    if (!readCSV(path, data))
+        return false;
+
+    byteProfile.clear();
+    for (auto &fields : data)
+    {
+        // Malformed rows are skipped
+        if ((fields.size() != 2) || (fields[0].size() != 6) || fields[1].empty())
+            continue;
+
+        char *trigramEnd;
+        char *countEnd;
+        unsigned long trigram = strtoul(fields[0].c_str(), &trigramEnd, 16);
+        double count = strtod(fields[1].c_str(), &countEnd);
+        if (*trigramEnd || !isxdigit((unsigned char)fields[0][0]) || *countEnd || !(count > 0))
+            continue;
+
+        byteProfile[(uint32_t)trigram] = (float)count;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Writes a byte trigram profile to a CSV file, most frequent first.
+ *
+ * @param path The filename
+ * @param byteProfile The profile
+ * @return true Succeeded
+ * @return false Failed
+ */
+bool writeByteTrigramProfile(const string &path, const ByteTrigramProfile &byteProfile)
+{
+    vector<pair<float, uint32_t>> rows;
+    for (auto &entry : byteProfile)
+        rows.push_back(make_pair(entry.second, entry.first));
+
+    sort(rows.begin(), rows.end(),
+         [](const pair<float, uint32_t> &a, const pair<float, uint32_t> &b)
+         { return (a.first > b.first) || ((a.first == b.first) && (a.second < b.second)); });
+
+    CSVData data;
+    for (auto &row : rows)
+    {
+        char hex[8];
+        snprintf(hex, sizeof(hex), "%06x", row.second);
+        data.push_back({hex, to_string((long long)row.first)});
+    }
+
+    return writeCSV(path, data);
+}
+
+/**
+ * @brief Normalizes a byte trigram profile.
+ *
+ * @param byteProfile The profile
+ */
+void normalizeByteTrigramProfile(ByteTrigramProfile &byteProfile)
+{
+    float norm = 0.0f;
+    for (auto &entry : byteProfile)
+        norm += entry.second * entry.second;
+
+    norm = sqrt(norm);
+    if (norm == 0.0f)
+        return;
+
+    for (auto &entry : byteProfile)
+        entry.second /= norm;
+}
+
+/**
+ * @brief Builds the dense model from normalized byte trigram profiles.
+ *
+ * @param languageCodes Language code of each profile
+ * @param byteProfiles The profiles
+ * @param model Destination model
+ */
+void buildByteTrigramModel(const vector<string> &languageCodes,
+                           const vector<ByteTrigramProfile> &byteProfiles, ByteTrigramModel &model)
+{
+    model.languageCodes = languageCodes;
+
+    // Assigns row ids
+    unordered_map<uint32_t, uint32_t> trigramIds;
+    for (auto &byteProfile : byteProfiles)
+    {
+        for (auto &entry : byteProfile)
+            trigramIds.insert(make_pair(entry.first, (uint32_t)trigramIds.size()));
+    }
+    model.trigramNum = trigramIds.size();
+
+    // Open-addressing table at most half full
+    size_t slotNum = 16;
+    while (slotNum < 2 * model.trigramNum)
+        slotNum *= 2;
+    model.slotTrigrams.assign(slotNum, NO_BYTE_TRIGRAM);
+    model.slotIds.assign(slotNum, 0);
+    for (auto &entry : trigramIds)
+    {
+        size_t slot = getByteTrigramSlot(entry.first, slotNum - 1);
+        while (model.slotTrigrams[slot] != NO_BYTE_TRIGRAM)
+            slot = (slot + 1) & (slotNum - 1);
+
+        model.slotTrigrams[slot] = entry.first;
+        model.slotIds[slot] = entry.second;
+    }
+
+    // Fills the rows
+    model.rowSize = (languageCodes.size() + SIMD_ROW_ALIGNMENT - 1) / SIMD_ROW_ALIGNMENT * SIMD_ROW_ALIGNMENT;
+    model.weights.assign(model.trigramNum * model.rowSize, 0.0f);
+    for (size_t i = 0; i < byteProfiles.size(); i++)
+    {
+        for (auto &entry : byteProfiles[i])
+            model.weights[trigramIds[entry.first] * model.rowSize + i] = entry.second;
+    }
+}
+
+/**
+ * @brief Builds a byte trigram model from the code point trigram profiles.
+ *
+ * @param languages The trigram profiles
+ * @param model Destination model
+ */
+void buildByteTrigramModel(const LanguageProfiles &languages, ByteTrigramModel &model)
+{
+    vector<string> languageCodes;
+    vector<ByteTrigramProfile> byteProfiles;
+    for (auto &language : languages)
+    {
+        languageCodes.push_back(language.languageCode);
+        byteProfiles.push_back(ByteTrigramProfile());
+        deriveByteTrigramProfile(language.trigramProfile, byteProfiles.back());
+        normalizeByteTrigramProfile(byteProfiles.back());
+    }
+
+    buildByteTrigramModel(languageCodes, byteProfiles, model);
+}
+
+/**
+ * @brief Identifies the language of a text with the byte trigram model.
+ *
+ * Byte trigrams are mapped straight to row ids and counted in a per-thread
+ * buffer, so no per-text map is built. The text profile is not normalized:
+ * its norm scales every language score equally.
+ *
+ * @param text A Text (vector of lines)
+ * @param model The byte trigram model
+ * @return string The language code of the most likely language
+ */
+string identifyLanguage(const Text &text, const ByteTrigramModel &model)
+{
+    if (model.languageCodes.empty())
+        return "";
+
+    static thread_local vector<float> counts;
+    static thread_local vector<uint32_t> countedIds;
+    if (counts.size() < model.trigramNum)
+        counts.assign(model.trigramNum, 0.0f);
+    countedIds.clear();
+
+    for (auto &line : text)
+    {
+        forEachByteTrigram(line, [&model](uint32_t trigram)
+                           {
+            uint32_t id = model.findTrigram(trigram);
+            if (id == NO_BYTE_TRIGRAM)
+                return;
+
+            if (counts[id] == 0.0f)
+                countedIds.push_back(id);
+            counts[id] += 1.0f; });
+    }
+
+    vector<float> scores(model.rowSize, 0.0f);
+    for (uint32_t id : countedIds)
+    {
+        accumulateRow(model.getRow(id), counts[id], scores.data(), model.rowSize);
+        counts[id] = 0.0f;
+    }
+
+    float max = 0.0f;
+    string languageCode;
+    for (size_t i = 0; i < model.languageCodes.size(); i++)
+    {
+        if (scores[i] > max)
+        {
+            max = scores[i];
+            languageCode = model.languageCodes[i];
+        }
+    }
+
+    return languageCode;
+}
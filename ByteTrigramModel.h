@@ -0,0 +1,58 @@
+/**
+ * @brief Lequel? byte-level trigram model (no Unicode decoding)
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef BYTETRIGRAMMODEL_H
+#define BYTETRIGRAMMODEL_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Lequel.h"
+
+// ByteTrigramProfile: map of byte trigram (3 raw bytes, packed in 24 bits,
+// first byte most significant) -> frequency
+typedef std::unordered_map<uint32_t, float> ByteTrigramProfile;
+
+// ByteTrigramModel: dense byte-trigram-major weight matrix, like
+// LanguageModel. Byte trigrams map to row ids through an open-addressing
+// table.
+struct ByteTrigramModel
+{
+    std::vector<std::string> languageCodes;
+
+    std::vector<uint32_t> slotTrigrams;
+    std::vector<uint32_t> slotIds;
+    size_t trigramNum;
+
+    size_t rowSize;
+    std::vector<float> weights;
+
+    uint32_t findTrigram(uint32_t trigram) const;
+
+    const float *getRow(uint32_t trigramId) const
+    {
+        return &weights[trigramId * rowSize];
+    }
+};
+
+// Functions
+void buildByteTrigramProfile(const Text &text, ByteTrigramProfile &byteProfile);
+void deriveByteTrigramProfile(const TrigramProfile &trigramProfile, ByteTrigramProfile &byteProfile);
+void trainByteTrigramProfile(const Text &corpus, size_t maxTrigramNum, ByteTrigramProfile &byteProfile);
+bool readByteTrigramProfile(const std::string &path, ByteTrigramProfile &byteProfile);
+bool writeByteTrigramProfile(const std::string &path, const ByteTrigramProfile &byteProfile);
+void normalizeByteTrigramProfile(ByteTrigramProfile &byteProfile);
+
+void buildByteTrigramModel(const std::vector<std::string> &languageCodes,
+                           const std::vector<ByteTrigramProfile> &byteProfiles,
+                           ByteTrigramModel &model);
+void buildByteTrigramModel(const LanguageProfiles &languages, ByteTrigramModel &model);
+std::string identifyLanguage(const Text &text, const ByteTrigramModel &model);
+
+#endif
@@ -0,0 +1,140 @@
+/**
+ * @brief Lequel? case folding of code points
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ *
+ * @cite https://www.unicode.org/Public/UCD/latest/ucd/CaseFolding.txt
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+#include "CaseFolding.h"
+#include "Text.h"
+
+using namespace std;
+
+// How a range folds: every code point by a delta, or only its even (or odd)
+// code points, each to the next one (upper/lowercase pairs)
+enum CaseFoldingType
+{
+    FOLD_DELTA,
+    FOLD_EVEN,
+    FOLD_ODD,
+};
+
+struct CaseFoldingRange
+{
+    char32_t first;
+    char32_t last;
+    int32_t delta;
+    CaseFoldingType type;
+};
+
+// ASCII, Latin-1, Latin Extended-A/B, Latin Extended Additional, Greek, Cyrillic
+// and Armenian, sorted by first code point
+static const CaseFoldingRange caseFoldingRanges[] = {
+    {'A', 'Z', 0x20, FOLD_DELTA},
+    {0x00c0, 0x00d6, 0x20, FOLD_DELTA},
+    {0x00d8, 0x00de, 0x20, FOLD_DELTA},
+    {0x0100, 0x012f, 1, FOLD_EVEN},
+    {0x0130, 0x0130, 0x0069 - 0x0130, FOLD_DELTA},
+    {0x0132, 0x0137, 1, FOLD_EVEN},
+    {0x0139, 0x0148, 1, FOLD_ODD},
+    {0x014a, 0x0177, 1, FOLD_EVEN},
+    {0x0178, 0x0178, 0x00ff - 0x0178, FOLD_DELTA},
+    {0x0179, 0x017e, 1, FOLD_ODD},
+    {0x01cd, 0x01dc, 1, FOLD_ODD},
+    {0x01de, 0x01ef, 1, FOLD_EVEN},
+    {0x01f8, 0x021f, 1, FOLD_EVEN},
+    {0x0222, 0x0233, 1, FOLD_EVEN},
+    {0x0386, 0x0386, 0x03ac - 0x0386, FOLD_DELTA},
+    {0x0388, 0x038a, 0x03ad - 0x0388, FOLD_DELTA},
+    {0x038c, 0x038c, 0x03cc - 0x038c, FOLD_DELTA},
+    {0x038e, 0x038f, 0x03cd - 0x038e, FOLD_DELTA},
+    {0x0391, 0x03a1, 0x20, FOLD_DELTA},
+    {0x03a3, 0x03ab, 0x20, FOLD_DELTA},
+    {0x03c2, 0x03c2, 1, FOLD_DELTA},
+    {0x0400, 0x040f, 0x50, FOLD_DELTA},
+    {0x0410, 0x042f, 0x20, FOLD_DELTA},
+    {0x0460, 0x0481, 1, FOLD_EVEN},
+    {0x048a, 0x04bf, 1, FOLD_EVEN},
+    {0x04c0, 0x04c0, 0x04cf - 0x04c0, FOLD_DELTA},
+    {0x04c1, 0x04ce, 1, FOLD_ODD},
+    {0x04d0, 0x052f, 1, FOLD_EVEN},
+    {0x0531, 0x0556, 0x30, FOLD_DELTA},
+    {0x1e00, 0x1e95, 1, FOLD_EVEN},
+    {0x1ea0, 0x1eff, 1, FOLD_EVEN},
+};
+
+int16_t caseFoldingDeltas[CASEFOLDING_TABLE_SIZE];
+
+/**
+ * @brief Fills caseFoldingDeltas from the ranges.
+ */
+static bool buildCaseFoldingDeltas()
+{
+    for (auto &range : caseFoldingRanges)
+    {
+        for (char32_t c = range.first; (c <= range.last) && (c < CASEFOLDING_TABLE_SIZE); c++)
+        {
+            if (range.type == FOLD_DELTA)
+                caseFoldingDeltas[c] = (int16_t)range.delta;
+            else if ((c & 1) == (range.type == FOLD_ODD))
+                caseFoldingDeltas[c] = 1;
+        }
+    }
+
+    return true;
+}
+
+static bool caseFoldingDeltasBuilt = buildCaseFoldingDeltas();
+
+/**
+ * @brief Folds the case of a code point with the range table. Called by
+ * foldCase() above the delta table.
+ *
+ * @param c The code point
+ * @return char32_t The folded code point
+ */
+char32_t foldNonAsciiCase(char32_t c)
+{
+    if (c > caseFoldingRanges[size(caseFoldingRanges) - 1].last)
+        return c;
+
+    // First range ending at or after c
+    auto range = lower_bound(begin(caseFoldingRanges), end(caseFoldingRanges), c,
+                             [](const CaseFoldingRange &range, char32_t c)
+                             { return range.last < c; });
+    if ((range == end(caseFoldingRanges)) || (c < range->first))
+        return c;
+
+    switch (range->type)
+    {
+    case FOLD_EVEN:
+        return (c & 1) ? c : c + 1;
+    case FOLD_ODD:
+        return (c & 1) ? c + 1 : c;
+    default:
+        return c + range->delta;
+    }
+}
+
+/**
+ * @brief Folds the case of a UTF-8 string.
+ *
+ * @param s The string, encoded as UTF-8
+ * @return string The folded string
+ */
+string getFoldedString(const string &s)
+{
+    string folded;
+    folded.reserve(s.size());
+
+    for (size_t position = 0; position < s.size();)
+        appendUTF8(folded, foldCase(getNextUTF8(s, position)));
+
+    return folded;
+}
@@ -0,0 +1,43 @@
+/**
+ * @brief Lequel? case folding of code points
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef CASEFOLDING_H
+#define CASEFOLDING_H
+
+#include <cstdint>
+#include <string>
+
+// Code points folded by table lookup: ASCII, Latin-1, Latin Extended-A/B,
+// Greek, Cyrillic and Armenian. Above it, foldNonAsciiCase() searches the
+// ranges
+const char32_t CASEFOLDING_TABLE_SIZE = 0x580;
+
+// Folding deltas of the code points below CASEFOLDING_TABLE_SIZE
+extern int16_t caseFoldingDeltas[CASEFOLDING_TABLE_SIZE];
+
+// Functions
+char32_t foldNonAsciiCase(char32_t c);
+std::string getFoldedString(const std::string &s);
+
+/**
+ * @brief Folds the case of a code point (simple case folding): uppercase
+ * letters become lowercase, and final sigma becomes sigma.
+ *
+ * The scripts most profiles use are folded with one table lookup.
+ *
+ * @param c The code point
+ * @return char32_t The folded code point
+ */
+inline char32_t foldCase(char32_t c)
+{
+    if (c < CASEFOLDING_TABLE_SIZE)
+        return c + caseFoldingDeltas[c];
+
+    return foldNonAsciiCase(c);
+}
+
+#endif
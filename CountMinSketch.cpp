@@ -0,0 +1,144 @@
+/**
+ * @brief Lequel? Count-Min sketch
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ *
+ * @cite http://dimacs.rutgers.edu/~graham/pubs/papers/cm-full.pdf
+ */
+
+#include <algorithm>
+
+#include "CountMinSketch.h"
+
+/**
+ * @brief Allocates an empty sketch.
+ *
+ * @param width Counters per row (rounded up to a power of two)
+ * @param depth Number of rows (at most COUNTMINSKETCH_MAX_DEPTH)
+ */
+CountMinSketch::CountMinSketch(size_t width, size_t depth) : width(1),
+                                                             depth(depth ? depth : 1),
+                                                             total(0)
+{
+    while (this->width < width)
+        this->width <<= 1;
+    this->depth = std::min(this->depth, COUNTMINSKETCH_MAX_DEPTH);
+
+    counters.assign(this->width * this->depth, 0);
+    rowSums.assign(this->depth, 0);
+}
+
+/**
+ * @brief Counts an element.
+ *
+ * Uses conservative update: only the counters at the current minimum grow,
+ * which keeps the estimate an upper bound with less overcounting.
+ *
+ * @param hash The element's 64-bit hash
+ * @param count Occurrences to add
+ */
+void CountMinSketch::add(uint64_t hash, uint32_t count)
+{
+    uint32_t newCount = estimate(hash) + count;
+    for (size_t row = 0; row < depth; row++)
+    {
+        uint32_t &counter = counters[row * width + getIndex(hash, row)];
+        if (counter < newCount)
+        {
+            rowSums[row] += newCount - counter;
+            counter = newCount;
+        }
+    }
+
+    total += count;
+}
+
+/**
+ * @brief Estimates the count of an element.
+ *
+ * @param hash The element's 64-bit hash
+ * @return uint32_t Upper bound of the element's count
+ */
+uint32_t CountMinSketch::estimate(uint64_t hash) const
+{
+    uint32_t result = UINT32_MAX;
+    for (size_t row = 0; row < depth; row++)
+        result = std::min(result, counters[row * width + getIndex(hash, row)]);
+
+    return result;
+}
+
+/**
+ * @brief Estimates the count of an element with Count-Mean-Min: each row's
+ * counter, less the mean of the row's other counters (the collision noise
+ * an absent element picks up); the median over rows, clamped between 0 and
+ * estimate().
+ *
+ * Row sums are those of the conservatively updated counters, so the noise
+ * is not overestimated.
+ *
+ * @param hash The element's 64-bit hash
+ * @return uint32_t Estimate of the element's count
+ */
+uint32_t CountMinSketch::estimateCountMeanMin(uint64_t hash) const
+{
+    if (width < 2)
+        return estimate(hash);
+
+    uint32_t upperBound = UINT32_MAX;
+    double rowEstimates[COUNTMINSKETCH_MAX_DEPTH] = {0};
+    for (size_t row = 0; row < depth; row++)
+    {
+        uint32_t counter = counters[row * width + getIndex(hash, row)];
+        double noise = (double)(rowSums[row] - counter) / (width - 1);
+        rowEstimates[row] = counter - noise;
+        upperBound = std::min(upperBound, counter);
+    }
+
+    std::sort(rowEstimates, rowEstimates + depth);
+    double median = (depth & 1) ? rowEstimates[depth / 2]
+                                : (rowEstimates[depth / 2 - 1] + rowEstimates[depth / 2]) / 2;
+
+    if (median <= 0.0)
+        return 0;
+
+    return std::min(upperBound, (uint32_t)(median + 0.5));
+}
+
+/**
+ * @brief Resets all counts.
+ */
+void CountMinSketch::clear()
+{
+    std::fill(counters.begin(), counters.end(), 0);
+    std::fill(rowSums.begin(), rowSums.end(), 0);
+    total = 0;
+}
+
+/**
+ * @brief Sum of all counts added.
+ */
+uint64_t CountMinSketch::getTotal() const
+{
+    return total;
+}
+
+/**
+ * @brief Size of the counters, in bytes.
+ */
+size_t CountMinSketch::getByteSize() const
+{
+    return counters.size() * sizeof(uint32_t);
+}
+
+/**
+ * @brief Column of an element in a row, by double hashing both hash halves.
+ */
+size_t CountMinSketch::getIndex(uint64_t hash, size_t row) const
+{
+    uint32_t h1 = (uint32_t)hash;
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+
+    return (h1 + (uint32_t)row * h2) & (width - 1);
+}
@@ -0,0 +1,48 @@
+/**
+ * @brief Lequel? Count-Min sketch
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ *
+ * @cite http://dimacs.rutgers.edu/~graham/pubs/papers/cm-full.pdf
+ */
+
+#ifndef COUNTMINSKETCH_H
+#define COUNTMINSKETCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Most rows a sketch takes (more add little certainty)
+const size_t COUNTMINSKETCH_MAX_DEPTH = 16;
+
+// CountMinSketch: approximate counts of 64-bit hashes in fixed memory. An
+// estimate never undercounts, and overcounts by at most about
+// 2.7 * getTotal() / width with probability 1 - 2^-depth. The Count-Mean-Min
+// estimate subtracts each row's collision noise instead, so absent elements
+// estimate near 0.
+class CountMinSketch
+{
+public:
+    CountMinSketch(size_t width = 8192, size_t depth = 4);
+
+    void add(uint64_t hash, uint32_t count = 1);
+    uint32_t estimate(uint64_t hash) const;
+    uint32_t estimateCountMeanMin(uint64_t hash) const;
+    void clear();
+
+    uint64_t getTotal() const;
+    size_t getByteSize() const;
+
+private:
+    size_t getIndex(uint64_t hash, size_t row) const;
+
+    size_t width;
+    size_t depth;
+    uint64_t total;
+    std::vector<uint32_t> counters;
+    std::vector<uint64_t> rowSums;
+};
+
+#endif
@@ -0,0 +1,124 @@
+/**
+ * @brief Lequel? 64-bit hashing (xxHash64)
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ *
+ * @cite https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+ */
+
+#include <cstring>
+
+#include "Hash.h"
+
+const uint64_t PRIME64_1 = 0x9e3779b185ebca87ULL;
+const uint64_t PRIME64_2 = 0xc2b2ae3d27d4eb4fULL;
+const uint64_t PRIME64_3 = 0x165667b19e3779f9ULL;
+const uint64_t PRIME64_4 = 0x85ebca77c2b2ae63ULL;
+const uint64_t PRIME64_5 = 0x27d4eb2f165667c5ULL;
+
+static inline uint64_t rotateLeft(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const unsigned char *p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t read32(const unsigned char *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t round64(uint64_t accumulator, uint64_t input)
+{
+    accumulator += input * PRIME64_2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * PRIME64_1;
+}
+
+static inline uint64_t mergeRound64(uint64_t accumulator, uint64_t value)
+{
+    accumulator ^= round64(0, value);
+    return accumulator * PRIME64_1 + PRIME64_4;
+}
+
+/**
+ * @brief Computes the xxHash64 of a block of memory.
+ *
+ * Reads are little-endian, as on every platform Lequel? targets.
+ *
+ * @param data The data
+ * @param size Size of the data, in bytes
+ * @param seed Hash seed
+ * @return uint64_t The hash
+ */
+uint64_t getHash64(const void *data, size_t size, uint64_t seed)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    const unsigned char *end = p + size;
+    uint64_t hash;
+
+    if (size >= 32)
+    {
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+
+        const unsigned char *limit = end - 32;
+        do
+        {
+            v1 = round64(v1, read64(p));
+            v2 = round64(v2, read64(p + 8));
+            v3 = round64(v3, read64(p + 16));
+            v4 = round64(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        hash = mergeRound64(hash, v1);
+        hash = mergeRound64(hash, v2);
+        hash = mergeRound64(hash, v3);
+        hash = mergeRound64(hash, v4);
+    }
+    else
+        hash = seed + PRIME64_5;
+
+    hash += size;
+
+    while (p + 8 <= end)
+    {
+        hash ^= round64(0, read64(p));
+        hash = rotateLeft(hash, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+
+    if (p + 4 <= end)
+    {
+        hash ^= (uint64_t)read32(p) * PRIME64_1;
+        hash = rotateLeft(hash, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+
+    while (p < end)
+    {
+        hash ^= (*p) * PRIME64_5;
+        hash = rotateLeft(hash, 11) * PRIME64_1;
+        p++;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
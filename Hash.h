@@ -0,0 +1,25 @@
+/**
+ * @brief Lequel? 64-bit hashing (xxHash64)
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ *
+ * @cite https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+ */
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Functions
+uint64_t getHash64(const void *data, size_t size, uint64_t seed = 0);
+
+inline uint64_t getHash64(const std::string &s, uint64_t seed = 0)
+{
+    return getHash64(s.data(), s.size(), seed);
+}
+
+#endif
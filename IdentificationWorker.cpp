@@ -0,0 +1,173 @@
+/**
+ * @brief Lequel? background identification worker
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include <stdexcept>
+
+#include "IdentificationWorker.h"
+
+using namespace std;
+
+/**
+ * @brief Starts the worker thread.
+ *
+ * @param model The language model (must outlive the worker)
+ */
+IdentificationWorker::IdentificationWorker(const LanguageModel &model) : model(model),
+                                                                      shouldStop(false)
+{
+    thread = std::thread(&IdentificationWorker::run, this);
+}
+
+/**
+ * @brief Cancels any job in progress and joins the worker thread.
+ */
+IdentificationWorker::~IdentificationWorker()
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        shouldStop = true;
+        if (pendingJob)
+            pendingJob->progress.cancelled = true;
+    }
+    if (currentJob)
+        currentJob->progress.cancelled = true;
+
+    condition.notify_one();
+    thread.join();
+}
+
+/**
+ * @brief Queues identification of a string, replacing the current job.
+ *
+ * @param s The string
+ */
+void IdentificationWorker::identifyString(const string &s)
+{
+    shared_ptr<Job> job = make_shared<Job>();
+    job->isFile = false;
+    job->input = s;
+
+    submit(job);
+}
+
+/**
+ * @brief Queues identification of a file, replacing the current job.
+ *
+ * @param path Path of file to identify
+ */
+void IdentificationWorker::identifyFile(const string &path)
+{
+    shared_ptr<Job> job = make_shared<Job>();
+    job->isFile = true;
+    job->input = path;
+
+    submit(job);
+}
+
+/**
+ * @brief Whether a job was submitted and has not been polled yet.
+ */
+bool IdentificationWorker::isBusy() const
+{
+    return currentJob && !currentJob->done.load(memory_order_acquire);
+}
+
+/**
+ * @brief Progress of the current job.
+ *
+ * @return float Fraction in [0, 1]
+ */
+float IdentificationWorker::getProgress() const
+{
+    if (!currentJob)
+        return 0.0f;
+
+    size_t total = currentJob->progress.total.load(memory_order_relaxed);
+    size_t current = currentJob->progress.current.load(memory_order_relaxed);
+    if (!total)
+        return 0.0f;
+
+    return current >= total ? 1.0f : (float)current / (float)total;
+}
+
+/**
+ * @brief Fetches the result of the current job, if it finished.
+ *
+ * @param languageCode Destination language code
+ * @return true A result was available
+ * @return false The job is still running, or there is no job
+ */
+bool IdentificationWorker::pollResult(string &languageCode)
+{
+    if (!currentJob || !currentJob->done.load(memory_order_acquire))
+        return false;
+
+    languageCode = currentJob->languageCode;
+    currentJob.reset();
+
+    return true;
+}
+
+/**
+ * @brief Cancels the current job and hands a new one to the worker.
+ *
+ * @param job The job
+ */
+void IdentificationWorker::submit(const shared_ptr<Job> &job)
+{
+    if (currentJob)
+        currentJob->progress.cancelled = true;
+    currentJob = job;
+
+    {
+        lock_guard<std::mutex> lock(mutex);
+        pendingJob = job;
+    }
+    condition.notify_one();
+}
+
+/**
+ * @brief Worker thread loop.
+ */
+void IdentificationWorker::run()
+{
+    while (true)
+    {
+        shared_ptr<Job> job;
+        {
+            unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]
+                           { return shouldStop || pendingJob; });
+            if (shouldStop)
+                return;
+
+            job.swap(pendingJob);
+        }
+
+        string languageCode;
+        try
+        {
+            Text text;
+            bool succeeded = job->isFile
+                                 ? getTextFromFile(job->input, text)
+                                 : getTextFromString(job->input, text);
+            if (succeeded)
+                languageCode = identifyLanguage(text, model, &job->progress);
+        }
+        catch (const exception &)
+        {
+            // Not UTF-8 text (e.g. a binary file)
+            languageCode.clear();
+        }
+
+        if (job->progress.cancelled)
+            continue;
+
+        job->languageCode = languageCode;
+        job->done.store(true, memory_order_release);
+    }
+}
@@ -0,0 +1,66 @@
+/**
+ * @brief Lequel? background identification worker
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef IDENTIFICATIONWORKER_H
+#define IDENTIFICATIONWORKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "LanguageModel.h"
+
+// IdentificationWorker: runs getTextFromFile() and identifyLanguage() on a
+// worker thread, so the render loop never blocks on an identification.
+//
+// A new job cancels the one in progress. Results are published through an
+// atomic flag on the job; the render thread polls it and never takes a lock
+// to read progress or results.
+class IdentificationWorker
+{
+public:
+    IdentificationWorker(const LanguageModel &model);
+    ~IdentificationWorker();
+
+    void identifyString(const std::string &s);
+    void identifyFile(const std::string &path);
+
+    bool isBusy() const;
+    float getProgress() const;
+    bool pollResult(std::string &languageCode);
+
+private:
+    struct Job
+    {
+        bool isFile;
+        std::string input;
+        IdentificationProgress progress;
+        std::string languageCode;
+        std::atomic<bool> done{false};
+    };
+
+    void submit(const std::shared_ptr<Job> &job);
+    void run();
+
+    const LanguageModel &model;
+
+    // Owned by the render thread
+    std::shared_ptr<Job> currentJob;
+
+    // Hand-off to the worker thread
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::shared_ptr<Job> pendingJob;
+    bool shouldStop;
+
+    std::thread thread;
+};
+
+#endif
@@ -0,0 +1,172 @@
+/**
+ * @brief Lequel? incremental identification of editable text
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include "CaseFolding.h"
+#include "IncrementalProfile.h"
+#include "SimdKernels.h"
+
+using namespace std;
+
+/**
+ * @brief Creates an empty editable text.
+ *
+ * @param model The language model (must outlive this object)
+ */
+IncrementalProfile::IncrementalProfile(const LanguageModel &model) : model(model),
+                                                                     dotProducts(model.rowSize, 0.0f),
+                                                                     trigramNum(0)
+{
+}
+
+/**
+ * @brief Inserts a code point.
+ *
+ * @param position Insertion position, in code points
+ * @param c The code point
+ */
+void IncrementalProfile::insert(size_t position, char32_t c)
+{
+    if (position > text.size())
+        position = text.size();
+
+    size_t begin = position >= 2 ? position - 2 : 0;
+
+    // Trigrams spanning the insertion point are split by the new code point
+    updateTrigrams(begin, position, -1.0f);
+    text.insert(text.begin() + position, c);
+    updateTrigrams(begin, position + 1, 1.0f);
+}
+
+/**
+ * @brief Erases code points.
+ *
+ * @param position Position of the first code point to erase
+ * @param length Number of code points to erase
+ */
+void IncrementalProfile::erase(size_t position, size_t length)
+{
+    if (position >= text.size())
+        return;
+    if (length > text.size() - position)
+        length = text.size() - position;
+
+    size_t begin = position >= 2 ? position - 2 : 0;
+
+    // Trigrams overlapping the erased range go away, and new ones span the join
+    updateTrigrams(begin, position + length, -1.0f);
+    text.erase(position, length);
+    updateTrigrams(begin, position, 1.0f);
+}
+
+/**
+ * @brief Erases all text.
+ */
+void IncrementalProfile::clear()
+{
+    text.clear();
+    dotProducts.assign(model.rowSize, 0.0f);
+    trigramNum = 0;
+}
+
+/**
+ * @brief Length of the text, in code points.
+ */
+size_t IncrementalProfile::size() const
+{
+    return text.size();
+}
+
+/**
+ * @brief Returns the text, encoded as UTF-8.
+ */
+string IncrementalProfile::getText() const
+{
+    string s;
+    for (char32_t c : text)
+        appendUTF8(s, c);
+
+    return s;
+}
+
+/**
+ * @brief Identifies the language of the current text.
+ *
+ * Equivalent to identifyLanguage() on the whole text: language profiles are
+ * normalized, so the text norm scales every cosine similarity equally and
+ * the largest dot product wins.
+ *
+ * @return string The language code of the most likely language
+ */
+string IncrementalProfile::identifyLanguage() const
+{
+    float max = 0.0f;
+    string languageCode;
+    for (size_t i = 0; i < model.languageCodes.size(); i++)
+    {
+        if (dotProducts[i] > max)
+        {
+            max = dotProducts[i];
+            languageCode = model.languageCodes[i];
+        }
+    }
+
+    return languageCode;
+}
+
+/**
+ * @brief Adds the rows of the trigrams starting at positions [begin, end)
+ * to the dot products.
+ *
+ * @param begin First position
+ * @param end Past-the-end position
+ * @param count 1 to count the trigrams, -1 to uncount them
+ */
+void IncrementalProfile::updateTrigrams(size_t begin, size_t end, float count)
+{
+    string trigram;
+    for (size_t i = begin; i < end; i++)
+    {
+        if (!getTrigram(i, trigram))
+            continue;
+
+        uint32_t id = model.vocabulary.find(trigram);
+        if (id == NO_TRIGRAM_ID)
+            continue;
+
+        accumulateRow(model.getRow(id), count, dotProducts.data(), model.rowSize);
+        trigramNum += count > 0 ? 1 : -1;
+    }
+
+    // Drops the rounding residue once no trigram is left
+    if (!trigramNum)
+        dotProducts.assign(model.rowSize, 0.0f);
+}
+
+/**
+ * @brief Gets the trigram starting at a position.
+ *
+ * @param position Position, in code points
+ * @param trigram Destination trigram, encoded as UTF-8
+ * @return true The trigram exists (trigrams do not cross line breaks)
+ * @return false There is no trigram at this position
+ */
+bool IncrementalProfile::getTrigram(size_t position, string &trigram) const
+{
+    if (position + 3 > text.size())
+        return false;
+
+    trigram.clear();
+    for (size_t i = position; i < position + 3; i++)
+    {
+        if (text[i] == '\n')
+            return false;
+
+        appendUTF8(trigram, foldCase(text[i]));
+    }
+
+    return true;
+}
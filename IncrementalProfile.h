@@ -0,0 +1,46 @@
+/**
+ * @brief Lequel? incremental identification of editable text
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef INCREMENTALPROFILE_H
+#define INCREMENTALPROFILE_H
+
+#include <string>
+#include <vector>
+
+#include "LanguageModel.h"
+
+// IncrementalProfile: an editable text together with the dot product of its
+// trigram counts with every language profile.
+//
+// An edit only removes and re-adds the trigrams that overlap it, so the cost
+// of re-identifying after a keystroke does not depend on the text length.
+class IncrementalProfile
+{
+public:
+    IncrementalProfile(const LanguageModel &model);
+
+    void insert(size_t position, char32_t c);
+    void erase(size_t position, size_t length = 1);
+    void clear();
+
+    size_t size() const;
+    std::string getText() const;
+
+    std::string identifyLanguage() const;
+
+private:
+    void updateTrigrams(size_t begin, size_t end, float count);
+    bool getTrigram(size_t position, std::string &trigram) const;
+
+    const LanguageModel &model;
+
+    std::u32string text;
+    std::vector<float> dotProducts;
+    size_t trigramNum;
+};
+
+#endif
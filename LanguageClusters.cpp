@@ -0,0 +1,178 @@
+/**
+ * @brief Lequel? two-stage identification by language cluster
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ *
+ * @cite https://en.wikipedia.org/wiki/UPGMA
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "LanguageClusters.h"
+#include "SimdKernels.h"
+
+using namespace std;
+
+/**
+ * @brief Groups the model's languages into clusters, and builds their centroids.
+ *
+ * Average-linkage agglomerative clustering: starting from one cluster per
+ * language, the two clusters with the highest average pairwise cosine
+ * similarity merge, until no pair reaches the threshold.
+ *
+ * @param model The language model
+ * @param clusters Destination clusters
+ * @param threshold Smallest average similarity of clusters that merge
+ */
+void buildLanguageClusters(const LanguageModel &model, LanguageClusters &clusters, float threshold)
+{
+    size_t languageNum = model.languageCodes.size();
+
+    // Pairwise similarities
+    vector<float> similarities(languageNum * languageNum);
+    for (size_t i = 0; i < languageNum; i++)
+    {
+        for (size_t j = i; j < languageNum; j++)
+        {
+            float similarity = getCosineSimilarity(model.languageProfiles[i], model.languageProfiles[j]);
+            similarities[i * languageNum + j] = similarity;
+            similarities[j * languageNum + i] = similarity;
+        }
+    }
+
+    clusters.members.clear();
+    for (uint32_t i = 0; i < languageNum; i++)
+        clusters.members.push_back(vector<uint32_t>(1, i));
+
+    while (true)
+    {
+        float maxSimilarity = threshold;
+        size_t mergeA = 0;
+        size_t mergeB = 0;
+        for (size_t a = 0; a < clusters.members.size(); a++)
+        {
+            for (size_t b = a + 1; b < clusters.members.size(); b++)
+            {
+                float sum = 0.0f;
+                for (uint32_t i : clusters.members[a])
+                {
+                    for (uint32_t j : clusters.members[b])
+                        sum += similarities[i * languageNum + j];
+                }
+
+                float similarity = sum / (clusters.members[a].size() * clusters.members[b].size());
+                if (similarity >= maxSimilarity)
+                {
+                    maxSimilarity = similarity;
+                    mergeA = a;
+                    mergeB = b;
+                }
+            }
+        }
+
+        if (mergeA == mergeB)
+            break;
+
+        clusters.members[mergeA].insert(clusters.members[mergeA].end(),
+                                        clusters.members[mergeB].begin(), clusters.members[mergeB].end());
+        clusters.members.erase(clusters.members.begin() + mergeB);
+    }
+
+    // Centroids
+    size_t clusterNum = clusters.members.size();
+    clusters.rowSize = (clusterNum + SIMD_ROW_ALIGNMENT - 1) / SIMD_ROW_ALIGNMENT * SIMD_ROW_ALIGNMENT;
+    clusters.weights.assign(model.vocabulary.size() * clusters.rowSize, 0.0f);
+
+    for (size_t c = 0; c < clusterNum; c++)
+    {
+        for (uint32_t i : clusters.members[c])
+        {
+            for (auto &entry : model.languageProfiles[i])
+                clusters.weights[entry.first * clusters.rowSize + c] += entry.second;
+        }
+
+        float norm = 0.0f;
+        for (uint32_t id = 0; id < model.vocabulary.size(); id++)
+            norm += clusters.weights[id * clusters.rowSize + c] * clusters.weights[id * clusters.rowSize + c];
+
+        norm = sqrt(norm);
+        if (norm == 0.0f)
+            continue;
+
+        for (uint32_t id = 0; id < model.vocabulary.size(); id++)
+            clusters.weights[id * clusters.rowSize + c] /= norm;
+    }
+}
+
+/**
+ * @brief Identifies the language of a text in two stages.
+ *
+ * The text is first scored against the cluster centroids, and then against
+ * the members of the CLUSTER_CANDIDATE_NUM best clusters only. This reads
+ * fewer weights than scoring every language, but a language whose cluster
+ * scores low can no longer win.
+ *
+ * @param text A Text (vector of lines)
+ * @param model The language model
+ * @param clusters The model's language clusters
+ * @param weightReads Optional counter, incremented by the weights read
+ * @param skipNoise Skip markup, URLs and numbers (see findNoiseSpans())
+ * @return string The language code of the most likely language
+ */
+string identifyLanguage(const Text &text, const LanguageModel &model, const LanguageClusters &clusters,
+                        uint64_t *weightReads, bool skipNoise)
+{
+    TrigramIdProfile textProfile;
+    buildTrigramIdProfile(text, model.vocabulary, textProfile, nullptr, skipNoise);
+    if (textProfile.empty() || clusters.members.empty())
+        return "";
+
+    // First stage
+    vector<float> clusterScores(clusters.rowSize, 0.0f);
+    for (auto &entry : textProfile)
+        accumulateRow(clusters.getRow(entry.first), entry.second, clusterScores.data(), clusters.rowSize);
+
+    vector<uint32_t> clusterOrder(clusters.members.size());
+    for (uint32_t c = 0; c < clusterOrder.size(); c++)
+        clusterOrder[c] = c;
+
+    size_t candidateNum = min(CLUSTER_CANDIDATE_NUM, clusterOrder.size());
+    partial_sort(clusterOrder.begin(), clusterOrder.begin() + candidateNum, clusterOrder.end(),
+                 [&clusterScores](uint32_t a, uint32_t b)
+                 { return clusterScores[a] > clusterScores[b]; });
+
+    // Second stage
+    vector<uint32_t> candidates;
+    for (size_t k = 0; k < candidateNum; k++)
+    {
+        const vector<uint32_t> &members = clusters.members[clusterOrder[k]];
+        candidates.insert(candidates.end(), members.begin(), members.end());
+    }
+    sort(candidates.begin(), candidates.end());
+
+    vector<float> scores(candidates.size(), 0.0f);
+    for (auto &entry : textProfile)
+    {
+        const float *row = model.getRow(entry.first);
+        for (size_t k = 0; k < candidates.size(); k++)
+            scores[k] += entry.second * row[candidates[k]];
+    }
+
+    if (weightReads)
+        *weightReads += textProfile.size() * (clusters.members.size() + candidates.size());
+
+    float max = 0.0f;
+    string languageCode;
+    for (size_t k = 0; k < candidates.size(); k++)
+    {
+        if (scores[k] > max)
+        {
+            max = scores[k];
+            languageCode = model.languageCodes[candidates[k]];
+        }
+    }
+
+    return languageCode;
+}
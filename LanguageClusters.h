@@ -0,0 +1,46 @@
+/**
+ * @brief Lequel? two-stage identification by language cluster
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef LANGUAGECLUSTERS_H
+#define LANGUAGECLUSTERS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "LanguageModel.h"
+
+// Average cosine similarity above which language clusters merge
+const float CLUSTER_SIMILARITY_THRESHOLD = 0.3f;
+
+// Clusters whose members are scored in the second stage
+const size_t CLUSTER_CANDIDATE_NUM = 2;
+
+// LanguageClusters: families of similar languages of a LanguageModel, each
+// with a normalized centroid profile (the mean of its members). Centroids
+// are stored like the model: one dense row of centroid weights per trigram.
+struct LanguageClusters
+{
+    std::vector<std::vector<uint32_t>> members;
+
+    size_t rowSize;
+    std::vector<float> weights;
+
+    const float *getRow(uint32_t trigramId) const
+    {
+        return &weights[trigramId * rowSize];
+    }
+};
+
+// Functions
+void buildLanguageClusters(const LanguageModel &model, LanguageClusters &clusters,
+                           float threshold = CLUSTER_SIMILARITY_THRESHOLD);
+std::string identifyLanguage(const Text &text, const LanguageModel &model,
+                             const LanguageClusters &clusters, uint64_t *weightReads = nullptr,
+                             bool skipNoise = false);
+
+#endif
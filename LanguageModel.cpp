@@ -0,0 +1,483 @@
+/**
+ * @brief Lequel? dense trigram-major language model
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "LanguageModel.h"
+#include "NgramProfile.h"
+#include "SimdKernels.h"
+#include "Tracing.h"
+
+using namespace std;
+
+static void orderByScoreBound(const TrigramIdProfile &textProfile, const LanguageModel &model,
+                              TrigramIdProfile &orderedProfile);
+static string getBestLanguage(const vector<float> &scores, const LanguageModel &model);
+
+/**
+ * @brief Builds the model from normalized language profiles.
+ *
+ * @param languages The trigram profiles
+ * @param model Destination model
+ */
+void buildLanguageModel(LanguageProfiles &languages, LanguageModel &model)
+{
+    model.languageCodes.clear();
+    model.vocabulary.clear();
+    model.languageProfiles.clear();
+
+    // Interns every trigram
+    for (auto &language : languages)
+    {
+        model.languageCodes.push_back(language.languageCode);
+        model.languageProfiles.push_back(TrigramIdProfile());
+        TrigramIdProfile &languageProfile = model.languageProfiles.back();
+
+        for (auto &entry : language.trigramProfile)
+            languageProfile.push_back(make_pair(model.vocabulary.intern(entry.first), entry.second));
+
+        sort(languageProfile.begin(), languageProfile.end());
+    }
+
+    buildLanguageModel(model);
+}
+
+/**
+ * @brief Completes a model from its language codes, vocabulary and
+ * normalized language id profiles (sorted by id), as when profiles are
+ * generated rather than loaded.
+ *
+ * @param model The model
+ */
+void buildLanguageModel(LanguageModel &model)
+{
+    // Hashes the packed keys, as buildTrigramProfile() does into a sketch
+    model.trigramHashes.resize(model.vocabulary.size());
+    for (uint32_t id = 0; id < model.vocabulary.size(); id++)
+    {
+        uint64_t key = 0;
+        getNgramKey<3>(model.vocabulary.getTrigram(id), key);
+        model.trigramHashes[id] = getTrigramKeyHash(key);
+    }
+
+    // Fills the rows
+    size_t languageNum = model.languageCodes.size();
+    model.rowSize = (languageNum + SIMD_ROW_ALIGNMENT - 1) / SIMD_ROW_ALIGNMENT * SIMD_ROW_ALIGNMENT;
+    model.weights.assign(model.vocabulary.size() * model.rowSize, 0.0f);
+
+    model.maxWeights.assign(languageNum, 0.0f);
+    model.trigramMaxWeights.assign(model.vocabulary.size(), 0.0f);
+    for (size_t i = 0; i < languageNum; i++)
+    {
+        for (auto &entry : model.languageProfiles[i])
+        {
+            model.weights[entry.first * model.rowSize + i] = entry.second;
+            model.maxWeights[i] = max(model.maxWeights[i], entry.second);
+            model.trigramMaxWeights[entry.first] = max(model.trigramMaxWeights[entry.first], entry.second);
+        }
+    }
+}
+
+/**
+ * @brief Builds the normalized trigram profile of a text, as vocabulary ids.
+ *
+ * Each distinct text trigram is looked up in the vocabulary once. Trigrams
+ * outside the vocabulary count towards the norm, but are not kept.
+ *
+ * @param text A Text (vector of lines)
+ * @param vocabulary The model vocabulary
+ * @param textProfile Destination profile
+ * @param progress Optional progress counters, advanced once per line
+ * @param skipNoise Skip markup, URLs and numbers (see findNoiseSpans())
+ */
+void buildTrigramIdProfile(const Text &text, const TrigramVocabulary &vocabulary,
+                           TrigramIdProfile &textProfile, IdentificationProgress *progress, bool skipNoise)
+{
+    TraceSpan span("buildTrigramIdProfile");
+
+    textProfile.clear();
+
+    TrigramProfile trigramProfile = buildTrigramProfile(text, progress, skipNoise);
+    if (trigramProfile.empty())
+        return;
+    normalizeTrigramProfile(trigramProfile);
+
+    for (auto &entry : trigramProfile)
+    {
+        uint32_t id = vocabulary.find(entry.first);
+        if (id != NO_TRIGRAM_ID)
+            textProfile.push_back(make_pair(id, entry.second));
+    }
+
+    sort(textProfile.begin(), textProfile.end());
+}
+
+/**
+ * @brief Calculates the cosine similarity between two id profiles.
+ *
+ * Both profiles are sorted by id, so a single merge pass finds the common
+ * trigrams.
+ *
+ * @param textProfile The text trigram profile
+ * @param languageProfile The language trigram profile
+ * @return float The cosine similarity score
+ */
+float getCosineSimilarity(const TrigramIdProfile &textProfile, const TrigramIdProfile &languageProfile)
+{
+    float result = 0;
+
+    auto textIt = textProfile.begin();
+    auto langIt = languageProfile.begin();
+    while ((textIt != textProfile.end()) && (langIt != languageProfile.end()))
+    {
+        if (textIt->first < langIt->first)
+            ++textIt;
+        else if (langIt->first < textIt->first)
+            ++langIt;
+        else
+        {
+            result += textIt->second * langIt->second;
+            ++textIt;
+            ++langIt;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Identifies the language of a text with the dense model.
+ *
+ * Scores all languages at once: for each text trigram, the scores vector
+ * accumulates the trigram's row times its frequency. Models with at least
+ * PRUNING_MIN_LANGUAGES languages also prune hopeless languages; smaller
+ * ones are cheaper to score exhaustively.
+ *
+ * @param text A Text (vector of lines)
+ * @param model The language model
+ * @param progress Optional progress counters and cancellation flag
+ * @param skipNoise Skip markup, URLs and numbers (see findNoiseSpans())
+ * @return string The language code of the most likely language
+ */
+string identifyLanguage(const Text &text, const LanguageModel &model, IdentificationProgress *progress,
+                        bool skipNoise)
+{
+    if (progress)
+        progress->total.store(text.size() + 1, memory_order_relaxed);
+
+    TrigramIdProfile textProfile;
+    buildTrigramIdProfile(text, model.vocabulary, textProfile, progress, skipNoise);
+    if (textProfile.empty() || model.languageCodes.empty())
+        return "";
+
+    if (progress && progress->cancelled.load(memory_order_relaxed))
+        return "";
+
+    bool pruning = model.languageCodes.size() >= PRUNING_MIN_LANGUAGES;
+    string languageCode = identifyLanguage(textProfile, model, pruning);
+
+    if (progress)
+        progress->current.fetch_add(1, memory_order_relaxed);
+
+    return languageCode;
+}
+
+/**
+ * @brief Identifies the language of a normalized text id profile.
+ *
+ * With pruning, each text trigram's largest possible contribution (its
+ * weight times the trigram's largest language weight) bounds what it can
+ * add to any score, as in WAND. Trigrams are scored in roughly descending
+ * bound, and PRUNING_ROUNDS times along the way each remaining language's
+ * score is bounded by the least of: the unscored trigrams' bounds, the
+ * remaining text norm (Cauchy-Schwarz, language profiles being normalized),
+ * and the remaining text weight times the language's largest weight.
+ * Languages whose bound falls below the leader's score drop out. Once few
+ * languages remain, only their weights are accumulated, and scoring stops
+ * when one language is left.
+ *
+ * Bounds keep a PRUNING_MARGIN of slack for rounding, so the result is the
+ * same as without pruning. Near ties that survive to the end are rescored
+ * in the exhaustive order. Profiles shorter than PRUNING_MIN_TRIGRAMS are
+ * always scored exhaustively.
+ *
+ * @param textProfile The normalized text trigram profile
+ * @param model The language model
+ * @param pruning Whether to prune hopeless languages
+ * @return string The language code of the most likely language
+ */
+string identifyLanguage(const TrigramIdProfile &textProfile, const LanguageModel &model, bool pruning)
+{
+    TraceSpan span("score");
+
+    if (textProfile.empty() || model.languageCodes.empty())
+        return "";
+
+    vector<float> scores(model.rowSize, 0.0f);
+
+    if (pruning && (textProfile.size() >= PRUNING_MIN_TRIGRAMS))
+    {
+        TrigramIdProfile orderedProfile;
+        orderByScoreBound(textProfile, model, orderedProfile);
+
+        double remainingSquareSum = 0.0;
+        double remainingSum = 0.0;
+        double remainingBound = 0.0;
+        for (auto &entry : orderedProfile)
+        {
+            remainingSquareSum += (double)entry.second * entry.second;
+            remainingSum += entry.second;
+            remainingBound += (double)entry.second * model.trigramMaxWeights[entry.first];
+        }
+
+        vector<uint32_t> candidates;
+        for (uint32_t i = 0; i < model.languageCodes.size(); i++)
+            candidates.push_back(i);
+        bool isSparse = false;
+
+        size_t interval = orderedProfile.size() / PRUNING_ROUNDS;
+
+        for (size_t k = 0; k < orderedProfile.size(); k++)
+        {
+            const pair<uint32_t, float> &entry = orderedProfile[k];
+            const float *row = model.getRow(entry.first);
+            if (isSparse)
+            {
+                for (uint32_t i : candidates)
+                    scores[i] += entry.second * row[i];
+            }
+            else
+                accumulateRow(row, entry.second, scores.data(), model.rowSize);
+
+            remainingSquareSum -= (double)entry.second * entry.second;
+            remainingSum -= entry.second;
+            remainingBound -= (double)entry.second * model.trigramMaxWeights[entry.first];
+
+            if (((k + 1) % interval) && (k + 1 < orderedProfile.size()))
+                continue;
+
+            float sharedBound = (float)min(remainingBound, sqrt(max(remainingSquareSum, 0.0)));
+
+            float leaderScore = 0.0f;
+            for (uint32_t i : candidates)
+                leaderScore = max(leaderScore, scores[i]);
+
+            size_t candidateNum = 0;
+            for (uint32_t i : candidates)
+            {
+                float bound = scores[i] + min(sharedBound, (float)remainingSum * model.maxWeights[i]);
+                if (bound + PRUNING_MARGIN >= leaderScore)
+                    candidates[candidateNum++] = i;
+            }
+            candidates.resize(candidateNum);
+
+            if (candidates.size() == 1)
+                return leaderScore > 0.0f ? model.languageCodes[candidates[0]] : "";
+
+            isSparse = candidates.size() * PRUNING_SPARSE_RATIO <= model.rowSize;
+        }
+
+        scores.assign(model.rowSize, 0.0f);
+    }
+
+    for (auto &entry : textProfile)
+        accumulateRow(model.getRow(entry.first), entry.second, scores.data(), model.rowSize);
+
+    return getBestLanguage(scores, model);
+}
+
+/**
+ * @brief Identifies the language of a text counted into a Count-Min sketch.
+ *
+ * Only the model's trigrams are queried, so the cost depends on the
+ * vocabulary size and not on the text. The text norm scales every score
+ * equally, so it is not needed. Counts are Count-Mean-Min estimates: the
+ * plain upper bound gives every trigram absent from a long text about
+ * total / width of collision noise, which favors languages with the most
+ * weight mass.
+ *
+ * @param textSketch The text trigram counts (see buildTrigramProfile())
+ * @param model The language model
+ * @return string The language code of the most likely language
+ */
+string identifyLanguage(const CountMinSketch &textSketch, const LanguageModel &model)
+{
+    TraceSpan span("score (sketch)");
+
+    if (!textSketch.getTotal() || model.languageCodes.empty())
+        return "";
+
+    vector<float> scores(model.rowSize, 0.0f);
+    for (uint32_t id = 0; id < model.trigramHashes.size(); id++)
+    {
+        uint32_t count = textSketch.estimateCountMeanMin(model.trigramHashes[id]);
+        if (count)
+            accumulateRow(model.getRow(id), (float)count, scores.data(), model.rowSize);
+    }
+
+    return getBestLanguage(scores, model);
+}
+
+/**
+ * @brief Compiles language codes into a language set of a model.
+ *
+ * @param languageCodes The candidate language codes
+ * @param model The language model
+ * @param languageSet Destination language set
+ * @return true Succeeded
+ * @return false A language code is not in the model
+ */
+bool buildLanguageSet(const vector<string> &languageCodes, const LanguageModel &model, LanguageSet &languageSet)
+{
+    languageSet.clear();
+
+    for (auto &languageCode : languageCodes)
+    {
+        auto i = find(model.languageCodes.begin(), model.languageCodes.end(), languageCode);
+        if (i == model.languageCodes.end())
+            return false;
+
+        languageSet.push_back((uint32_t)(i - model.languageCodes.begin()));
+    }
+
+    sort(languageSet.begin(), languageSet.end());
+    languageSet.erase(unique(languageSet.begin(), languageSet.end()), languageSet.end());
+
+    return true;
+}
+
+/**
+ * @brief Identifies the language of a text among candidate languages.
+ *
+ * @param text A Text (vector of lines)
+ * @param model The language model
+ * @param languageSet The candidate languages
+ * @param progress Optional progress counters and cancellation flag
+ * @param skipNoise Skip markup, URLs and numbers (see findNoiseSpans())
+ * @return string The language code of the most likely candidate
+ */
+string identifyLanguage(const Text &text, const LanguageModel &model, const LanguageSet &languageSet,
+                        IdentificationProgress *progress, bool skipNoise)
+{
+    if (progress)
+        progress->total.store(text.size() + 1, memory_order_relaxed);
+
+    TrigramIdProfile textProfile;
+    buildTrigramIdProfile(text, model.vocabulary, textProfile, progress, skipNoise);
+    if (progress && progress->cancelled.load(memory_order_relaxed))
+        return "";
+
+    string languageCode = identifyLanguage(textProfile, model, languageSet);
+
+    if (progress)
+        progress->current.fetch_add(1, memory_order_relaxed);
+
+    return languageCode;
+}
+
+/**
+ * @brief Identifies the language of a normalized text id profile among
+ * candidate languages.
+ *
+ * Only the candidates' weights are accumulated, as in the sparse phase of
+ * pruning, so other languages neither cost time nor win.
+ *
+ * @param textProfile The normalized text trigram profile
+ * @param model The language model
+ * @param languageSet The candidate languages
+ * @return string The language code of the most likely candidate
+ */
+string identifyLanguage(const TrigramIdProfile &textProfile, const LanguageModel &model,
+                        const LanguageSet &languageSet)
+{
+    TraceSpan span("score (language set)");
+
+    if (textProfile.empty() || languageSet.empty())
+        return "";
+
+    vector<float> scores(languageSet.size(), 0.0f);
+    for (auto &entry : textProfile)
+    {
+        const float *row = model.getRow(entry.first);
+        for (size_t k = 0; k < languageSet.size(); k++)
+            scores[k] += entry.second * row[languageSet[k]];
+    }
+
+    float max = 0.0f;
+    string languageCode;
+    for (size_t k = 0; k < languageSet.size(); k++)
+    {
+        if (scores[k] > max)
+        {
+            max = scores[k];
+            languageCode = model.languageCodes[languageSet[k]];
+        }
+    }
+
+    return languageCode;
+}
+
+/**
+ * @brief Orders a text profile by descending score bound, within a factor 2.
+ *
+ * A counting sort on the bound's binary exponent takes linear time, and is
+ * close enough to a full sort for pruning to work.
+ *
+ * @param textProfile The text trigram profile
+ * @param model The language model
+ * @param orderedProfile Destination profile
+ */
+static void orderByScoreBound(const TrigramIdProfile &textProfile, const LanguageModel &model,
+                              TrigramIdProfile &orderedProfile)
+{
+    const int BUCKET_NUM = 32;
+
+    vector<uint8_t> buckets(textProfile.size());
+    size_t bucketStarts[BUCKET_NUM + 1] = {0};
+    for (size_t k = 0; k < textProfile.size(); k++)
+    {
+        float bound = textProfile[k].second * model.trigramMaxWeights[textProfile[k].first];
+
+        int exponent;
+        frexp(bound, &exponent);
+        int bucket = bound > 0.0f ? min(max(-exponent, 0), BUCKET_NUM - 1) : BUCKET_NUM - 1;
+
+        buckets[k] = (uint8_t)bucket;
+        bucketStarts[bucket + 1]++;
+    }
+
+    for (int i = 0; i < BUCKET_NUM; i++)
+        bucketStarts[i + 1] += bucketStarts[i];
+
+    orderedProfile.resize(textProfile.size());
+    for (size_t k = 0; k < textProfile.size(); k++)
+        orderedProfile[bucketStarts[buckets[k]]++] = textProfile[k];
+}
+
+/**
+ * @brief Picks the language with the largest score.
+ *
+ * @param scores One score per language
+ * @param model The language model
+ * @return string The language code (empty if no score is positive)
+ */
+static string getBestLanguage(const vector<float> &scores, const LanguageModel &model)
+{
+    float max = 0.0f;
+    string languageCode;
+    for (size_t i = 0; i < model.languageCodes.size(); i++)
+    {
+        if (scores[i] > max)
+        {
+            max = scores[i];
+            languageCode = model.languageCodes[i];
+        }
+    }
+
+    return languageCode;
+}
@@ -0,0 +1,86 @@
+/**
+ * @brief Lequel? dense trigram-major language model
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef LANGUAGEMODEL_H
+#define LANGUAGEMODEL_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Lequel.h"
+#include "TrigramVocabulary.h"
+
+// Pruning in identifyLanguage(): rounds per text, the shortest text profile
+// and smallest model worth pruning, and the fraction of languages left
+// (1 / ratio) below which only their weights are accumulated
+const size_t PRUNING_ROUNDS = 16;
+const size_t PRUNING_MIN_TRIGRAMS = 64;
+const size_t PRUNING_MIN_LANGUAGES = 256;
+const size_t PRUNING_SPARSE_RATIO = 8;
+
+// Slack of pruning bounds, far above float rounding of normalized scores
+const float PRUNING_MARGIN = 1e-4f;
+
+// TrigramIdProfile: (trigram id, frequency) pairs, sorted by id
+typedef std::vector<std::pair<uint32_t, float>> TrigramIdProfile;
+
+// LanguageSet: candidate languages of a model, as sorted indices into its
+// languageCodes. Built once by buildLanguageSet(), then reused
+typedef std::vector<uint32_t> LanguageSet;
+
+// LanguageModel: the trigrams of all language profiles, interned once in a
+// shared vocabulary. Each language profile is kept as a TrigramIdProfile,
+// and each trigram has a dense row of its weights in all languages (0 where
+// a language lacks it). Rows are padded to a multiple of SIMD_ROW_ALIGNMENT
+// floats.
+struct LanguageModel
+{
+    std::vector<std::string> languageCodes;
+    TrigramVocabulary vocabulary;
+
+    // getTrigramKeyHash() of each trigram, to query a text's CountMinSketch
+    std::vector<uint64_t> trigramHashes;
+
+    std::vector<TrigramIdProfile> languageProfiles;
+
+    size_t rowSize;
+    std::vector<float> weights;
+
+    // Largest weight of each language and of each trigram, to bound scores
+    // while pruning
+    std::vector<float> maxWeights;
+    std::vector<float> trigramMaxWeights;
+
+    const float *getRow(uint32_t trigramId) const
+    {
+        return &weights[trigramId * rowSize];
+    }
+};
+
+// Functions
+void buildLanguageModel(LanguageProfiles &languages, LanguageModel &model);
+void buildLanguageModel(LanguageModel &model);
+void buildTrigramIdProfile(const Text &text, const TrigramVocabulary &vocabulary,
+                           TrigramIdProfile &textProfile,
+                           IdentificationProgress *progress = nullptr, bool skipNoise = false);
+float getCosineSimilarity(const TrigramIdProfile &textProfile, const TrigramIdProfile &languageProfile);
+std::string identifyLanguage(const Text &text, const LanguageModel &model,
+                             IdentificationProgress *progress = nullptr, bool skipNoise = false);
+std::string identifyLanguage(const TrigramIdProfile &textProfile, const LanguageModel &model,
+                             bool pruning = true);
+std::string identifyLanguage(const CountMinSketch &textSketch, const LanguageModel &model);
+
+bool buildLanguageSet(const std::vector<std::string> &languageCodes, const LanguageModel &model,
+                      LanguageSet &languageSet);
+std::string identifyLanguage(const Text &text, const LanguageModel &model, const LanguageSet &languageSet,
+                             IdentificationProgress *progress = nullptr, bool skipNoise = false);
+std::string identifyLanguage(const TrigramIdProfile &textProfile, const LanguageModel &model,
+                             const LanguageSet &languageSet);
+
+#endif
@@ -0,0 +1,443 @@
+/**
+ * @brief Lequel? language data loader
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "CSVData.h"
+#include "CaseFolding.h"
+#include "LanguagesData.h"
+
+using namespace std;
+
+const string LANGUAGECODE_NAMES_FILE = "resources/languagecode_names_es.csv";
+const string TRIGRAMS_PATH = "resources/trigrams/";
+const string LANGUAGES_CACHE_FILE = "resources/trigrams.cache";
+
+const uint32_t LANGUAGES_CACHE_MAGIC = 0x4351454c; // "LEQC"
+const uint32_t LANGUAGES_CACHE_VERSION = 2;
+
+// SourceFileKey: identifies the version of a file the cache was built from
+struct SourceFileKey
+{
+    std::string path;
+    uint64_t size;
+    int64_t mtime;
+};
+
+/**
+ * @brief Gets the size and modification time of a file.
+ *
+ * @param path Path of the file
+ * @param key Destination key
+ * @return true Succeeded
+ * @return false The file does not exist
+ */
+static bool getSourceFileKey(const string &path, SourceFileKey &key)
+{
+    struct stat fileStat;
+    if (stat(path.c_str(), &fileStat))
+        return false;
+
+    key.path = path;
+    key.size = (uint64_t)fileStat.st_size;
+#if defined(__linux__)
+    key.mtime = (int64_t)fileStat.st_mtim.tv_sec * 1000000000 + fileStat.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    key.mtime = (int64_t)fileStat.st_mtimespec.tv_sec * 1000000000 + fileStat.st_mtimespec.tv_nsec;
+#else
+    key.mtime = (int64_t)fileStat.st_mtime * 1000000000;
+#endif
+
+    return true;
+}
+
+// Cache file writer
+static void writeValue(ofstream &file, const void *value, size_t size)
+{
+    file.write((const char *)value, size);
+}
+
+static void writeUInt32(ofstream &file, uint32_t value)
+{
+    writeValue(file, &value, sizeof(value));
+}
+
+static void writeString(ofstream &file, const string &s)
+{
+    writeUInt32(file, (uint32_t)s.size());
+    writeValue(file, s.data(), s.size());
+}
+
+// Cache file reader, over the whole file in memory
+struct CacheReader
+{
+    const char *data;
+    size_t size;
+    size_t position;
+
+    bool read(void *value, size_t valueSize)
+    {
+        if (valueSize > size - position)
+            return false;
+
+        memcpy(value, data + position, valueSize);
+        position += valueSize;
+
+        return true;
+    }
+
+    bool readUInt32(uint32_t &value)
+    {
+        return read(&value, sizeof(value));
+    }
+
+    bool readString(string &s)
+    {
+        uint32_t length;
+        if (!readUInt32(length) || (length > size - position))
+            return false;
+
+        s.assign(data + position, length);
+        position += length;
+
+        return true;
+    }
+};
+
+/**
+ * @brief Loads trigram data from the binary cache.
+ *
+ * The cache is only used if every file it was built from still has the
+ * size and modification time recorded in it.
+ *
+ * @param languageCodeNames Map of language code vs. language name.
+ * @param languages The trigram profiles.
+ * @return true Succeeded
+ * @return false No cache, or the cache is stale
+ */
+static bool loadLanguagesCache(map<string, string> &languageCodeNames, LanguageProfiles &languages)
+{
+    ifstream file(LANGUAGES_CACHE_FILE, ios::binary);
+    if (!file.is_open())
+        return false;
+
+    string fileData((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    CacheReader reader = {fileData.data(), fileData.size(), 0};
+
+    uint32_t magic, version;
+    if (!reader.readUInt32(magic) || (magic != LANGUAGES_CACHE_MAGIC) ||
+        !reader.readUInt32(version) || (version != LANGUAGES_CACHE_VERSION))
+        return false;
+
+    // Checks the source files
+    uint32_t sourceFileNum;
+    if (!reader.readUInt32(sourceFileNum))
+        return false;
+
+    for (uint32_t i = 0; i < sourceFileNum; i++)
+    {
+        SourceFileKey cachedKey, key;
+        if (!reader.readString(cachedKey.path) ||
+            !reader.read(&cachedKey.size, sizeof(cachedKey.size)) ||
+            !reader.read(&cachedKey.mtime, sizeof(cachedKey.mtime)))
+            return false;
+
+        if (!getSourceFileKey(cachedKey.path, key) ||
+            (key.size != cachedKey.size) ||
+            (key.mtime != cachedKey.mtime))
+            return false;
+    }
+
+    // Reads the profiles
+    map<string, string> cachedLanguageCodeNames;
+    LanguageProfiles cachedLanguages;
+
+    uint32_t languageNum;
+    if (!reader.readUInt32(languageNum))
+        return false;
+
+    for (uint32_t i = 0; i < languageNum; i++)
+    {
+        string languageCode, languageName;
+        uint32_t trigramNum;
+        if (!reader.readString(languageCode) ||
+            !reader.readString(languageName) ||
+            !reader.readUInt32(trigramNum))
+            return false;
+
+        cachedLanguageCodeNames[languageCode] = languageName;
+        cachedLanguages.push_back(LanguageProfile());
+        LanguageProfile &language = cachedLanguages.back();
+        language.languageCode = languageCode;
+
+        string trigram;
+        float frequency;
+        for (uint32_t j = 0; j < trigramNum; j++)
+        {
+            if (!reader.readString(trigram) || !reader.read(&frequency, sizeof(frequency)))
+                return false;
+
+            // Written in map order, so every insertion goes at the end
+            language.trigramProfile.insert(language.trigramProfile.end(), make_pair(trigram, frequency));
+        }
+
+        buildTrigramFilter(language);
+    }
+
+    languageCodeNames.insert(cachedLanguageCodeNames.begin(), cachedLanguageCodeNames.end());
+    languages.splice(languages.end(), cachedLanguages);
+
+    return true;
+}
+
+/**
+ * @brief Writes trigram data in the binary cache format.
+ *
+ * @param path Path of the file to write
+ * @param sourceFiles Paths of the files the data was read from
+ * @param languageCodeNames Map of language code vs. language name.
+ * @param languages The trigram profiles.
+ * @return true Succeeded
+ * @return false Failed
+ */
+static bool writeLanguagesCache(const string &path, const vector<string> &sourceFiles,
+                                map<string, string> &languageCodeNames, LanguageProfiles &languages)
+{
+    {
+        ofstream file(path, ios::binary);
+        if (!file.is_open())
+            return false;
+
+        writeUInt32(file, LANGUAGES_CACHE_MAGIC);
+        writeUInt32(file, LANGUAGES_CACHE_VERSION);
+
+        writeUInt32(file, (uint32_t)sourceFiles.size());
+        for (auto &path : sourceFiles)
+        {
+            SourceFileKey key;
+            if (!getSourceFileKey(path, key))
+                return false;
+
+            writeString(file, key.path);
+            writeValue(file, &key.size, sizeof(key.size));
+            writeValue(file, &key.mtime, sizeof(key.mtime));
+        }
+
+        writeUInt32(file, (uint32_t)languages.size());
+        for (auto &language : languages)
+        {
+            writeString(file, language.languageCode);
+            writeString(file, languageCodeNames[language.languageCode]);
+            writeUInt32(file, (uint32_t)language.trigramProfile.size());
+            for (auto &entry : language.trigramProfile)
+            {
+                writeString(file, entry.first);
+                writeValue(file, &entry.second, sizeof(entry.second));
+            }
+        }
+
+        if (!file.good())
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Writes trigram data to the binary cache.
+ *
+ * The cache is written to a temporary file of this process and renamed, so
+ * a concurrent start never reads a partial cache, and concurrent writers
+ * do not write the same file.
+ *
+ * @param sourceFiles Paths of the files the data was read from
+ * @param languageCodeNames Map of language code vs. language name.
+ * @param languages The trigram profiles.
+ * @return true Succeeded
+ * @return false Failed
+ */
+static bool saveLanguagesCache(const vector<string> &sourceFiles,
+                               map<string, string> &languageCodeNames,
+                               LanguageProfiles &languages)
+{
+#ifdef _WIN32
+    string tempPath = LANGUAGES_CACHE_FILE + ".tmp" + to_string(_getpid());
+#else
+    string tempPath = LANGUAGES_CACHE_FILE + ".tmp" + to_string(getpid());
+#endif
+
+    if (!writeLanguagesCache(tempPath, sourceFiles, languageCodeNames, languages))
+    {
+        remove(tempPath.c_str());
+        return false;
+    }
+
+#ifdef _WIN32
+    // rename() does not replace existing files on Windows
+    remove(LANGUAGES_CACHE_FILE.c_str());
+#endif
+
+    if (rename(tempPath.c_str(), LANGUAGES_CACHE_FILE.c_str()))
+    {
+        remove(tempPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Reads and normalizes the trigram profile of a language.
+ *
+ * @param languageCode The language code
+ * @param language Destination profile
+ * @return true Succeeded
+ * @return false Failed
+ */
+static bool loadLanguageProfile(const string &languageCode, LanguageProfile &language)
+{
+    CSVData languageCSVData;
+    if (!readCSV(TRIGRAMS_PATH + languageCode + ".csv", languageCSVData))
+        return false;
+
+    language.languageCode = languageCode;
+
+    for (auto &fields : languageCSVData)
+    {
+        if (fields.size() != 2)
+            continue;
+
+        // Trigrams that differ only in case merge
+        string trigram = getFoldedString(fields[0]);
+        float frequency = (float)stoi(fields[1]);
+
+        language.trigramProfile[trigram] += frequency;
+    }
+
+    normalizeTrigramProfile(language.trigramProfile);
+    buildTrigramFilter(language);
+
+    return true;
+}
+
+/**
+ * @brief Loads trigram data.
+ *
+ * Trigram profiles are read on a thread pool, one language per task, and
+ * appended to languages in the order of the language code file. The parsed
+ * profiles are then saved to a binary cache, which later starts load
+ * instead as long as none of the CSV files changed.
+ *
+ * @param languageCodeNames Map of language code vs. language name (in i18n locale).
+ * @param languages The trigram profiles.
+ * @param threadPool Thread pool to load on (nullptr: a temporary pool)
+ * @return true Succeeded
+ * @return false Failed
+ */
+bool loadLanguagesData(map<string, string> &languageCodeNames, LanguageProfiles &languages,
+                       ThreadPool *threadPool)
+{
+    auto startTime = chrono::steady_clock::now();
+
+    if (loadLanguagesCache(languageCodeNames, languages))
+    {
+        double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        cerr << "Loaded " << languages.size() << " trigram profiles from cache in "
+             << elapsedMs << " ms." << endl;
+
+        return true;
+    }
+
+    // Reads available language codes
+    CSVData languageCodesCSVData;
+    if (!readCSV(LANGUAGECODE_NAMES_FILE, languageCodesCSVData))
+        return false;
+
+    vector<string> languageCodes;
+    for (auto &fields : languageCodesCSVData)
+    {
+        if (fields.size() != 2)
+            continue;
+
+        string languageCode = fields[0];
+        string languageName = fields[1];
+
+        languageCodeNames[languageCode] = languageName;
+        languageCodes.push_back(languageCode);
+    }
+
+    // Reads trigram profile for each language code
+    unique_ptr<ThreadPool> localThreadPool;
+    if (!threadPool)
+    {
+        localThreadPool.reset(new ThreadPool());
+        threadPool = localThreadPool.get();
+    }
+
+    vector<LanguageProfile> loadedLanguages(languageCodes.size());
+    unique_ptr<bool[]> succeeded(new bool[languageCodes.size()]());
+    for (size_t i = 0; i < languageCodes.size(); i++)
+    {
+        LanguageProfile *language = &loadedLanguages[i];
+        bool *languageSucceeded = &succeeded[i];
+        const string *languageCode = &languageCodes[i];
+        threadPool->submit([language, languageSucceeded, languageCode]()
+                           {
+            try
+            {
+                *languageSucceeded = loadLanguageProfile(*languageCode, *language);
+            }
+            catch (const exception &)
+            {
+                // Malformed frequency
+                *languageSucceeded = false;
+            } });
+    }
+    threadPool->wait();
+
+    size_t trigramNum = 0;
+    for (size_t i = 0; i < languageCodes.size(); i++)
+    {
+        if (!succeeded[i])
+        {
+            cerr << "Could not read trigram profile for language code \"" << languageCodes[i] << "\"." << endl;
+            return false;
+        }
+
+        trigramNum += loadedLanguages[i].trigramProfile.size();
+        languages.push_back(std::move(loadedLanguages[i]));
+    }
+
+    vector<string> sourceFiles(1, LANGUAGECODE_NAMES_FILE);
+    for (auto &languageCode : languageCodes)
+        sourceFiles.push_back(TRIGRAMS_PATH + languageCode + ".csv");
+    if (!saveLanguagesCache(sourceFiles, languageCodeNames, languages))
+        cerr << "Could not write trigram cache \"" << LANGUAGES_CACHE_FILE << "\"." << endl;
+
+    double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    cerr << "Loaded " << languageCodes.size() << " trigram profiles (" << trigramNum << " trigrams) in "
+         << elapsedMs << " ms on " << threadPool->size() << " threads." << endl;
+
+    return true;
+}
@@ -0,0 +1,22 @@
+/**
+ * @brief Lequel? language data loader
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef LANGUAGESDATA_H
+#define LANGUAGESDATA_H
+
+#include <map>
+#include <string>
+
+#include "Lequel.h"
+#include "ThreadPool.h"
+
+// Functions
+bool loadLanguagesData(std::map<std::string, std::string> &languageCodeNames,
+                       LanguageProfiles &languages,
+                       ThreadPool *threadPool = nullptr);
+
+#endif
@@ -8,46 +8,92 @@
  */
 
 #include <cmath>
-#include <codecvt>
-#include <locale>
 #include <iostream>
 
+#include "Hash.h"
 #include "Lequel.h"
+#include "NgramProfile.h"
+#include "Tracing.h"
 
 using namespace std;
 
+// Trigram filter counters
+static atomic<uint64_t> trigramLookups(0);
+static atomic<uint64_t> skippedTrigramLookups(0);
+static atomic<uint64_t> trigramFalsePositives(0);
+
 /**
  * @brief Builds a trigram profile from a given text.
  *
  * @param text Vector of lines (Text)
- * @return TrigramProfile The trigram profile
+ * @param progress Optional progress counters, advanced once per line
+ * @param skipNoise Skip markup, URLs and numbers (see findNoiseSpans())
+ * @return TrigramProfile The trigram profile (empty if cancelled)
  */
-TrigramProfile buildTrigramProfile(const Text& text)
+TrigramProfile buildTrigramProfile(const Text& text, IdentificationProgress *progress, bool skipNoise)
 {
-    wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+    TraceSpan span("buildTrigramProfile");
+
+    // Counts on packed keys, then converts each distinct trigram to UTF-8 once
+    NgramProfile<3> ngramProfile;
+    if (!buildNgramProfile<3>(text, ngramProfile, progress, skipNoise))
+        return TrigramProfile();
+
     TrigramProfile trigProfReturn;
-    
-    for (std::string line : text)
-    {
-        if (!line.empty() && line.back() == '\r')           //borrar el CRLF que aparece en algunos archivos
-            line.pop_back();
+    for (auto &entry : ngramProfile)
+        trigProfReturn[getNgramString<3>(entry.first)] = entry.second;
 
-        if (line.empty())                                   //Si la linea es null entonces cambia de linea
-            continue;
-        std::wstring wline = converter.from_bytes(line);    //UTF-8 -> Unicode
-        if (wline.size() < 3)                               // Si no hay al menos 3 code points, no hay trigramas
-            continue;
+    return trigProfReturn;
+}
 
-        for (auto i = 0; i + 2 < wline.size(); ++i)         //garantiza que existan 3 caracteres desde i en adelante. 
-        {
-            std::wstring wtri = wline.substr(i, 3);         //Toma el trigrama como subcadena Unicode de longitud 3 a partir de i
-            std::string tri = converter.to_bytes(wtri);     //Unicode -> UTF-8 para usar como clave std::string
+/**
+ * @brief Counts the trigrams of a text into a Count-Min sketch.
+ *
+ * Bounded mode of buildTrigramProfile(): memory stays at the sketch size
+ * however many distinct trigrams the text has. Trigrams are keyed by
+ * getTrigramKeyHash().
+ *
+ * @param text Vector of lines (Text)
+ * @param sketch Destination sketch (counts are added)
+ * @param progress Optional progress counters, advanced once per line
+ * @param skipNoise Skip markup, URLs and numbers (see findNoiseSpans())
+ * @return true Succeeded
+ * @return false Cancelled
+ */
+bool buildTrigramProfile(const Text &text, CountMinSketch &sketch, IdentificationProgress *progress,
+                         bool skipNoise)
+{
+    TraceSpan span("buildTrigramProfile (sketch)");
+
+    NoiseSpans noiseSpans;
 
-            trigProfReturn[tri] += 1.0f;                    //incrementa la cantidad del trigrama tri en el mapa trigProfReturn
+    for (auto &line : text)
+    {
+        if (progress)
+        {
+            if (progress->cancelled.load(memory_order_relaxed))
+                return false;
+            progress->current.fetch_add(1, memory_order_relaxed);
         }
+
+        if (skipNoise)
+            findNoiseSpans(line, line.size(), noiseSpans);
+        forEachNgram<3>(line, noiseSpans, [&sketch](uint64_t key)
+                        { sketch.add(getTrigramKeyHash(key)); });
     }
-    
-    return trigProfReturn;
+
+    return true;
+}
+
+/**
+ * @brief Hashes a packed trigram key (NgramKey<3>).
+ *
+ * @param trigramKey The packed trigram
+ * @return uint64_t The trigram's 64-bit hash
+ */
+uint64_t getTrigramKeyHash(uint64_t trigramKey)
+{
+    return getHash64(&trigramKey, sizeof(trigramKey));
 }
 
 /**
@@ -57,6 +103,8 @@ TrigramProfile buildTrigramProfile(const Text& text)
  */
 void normalizeTrigramProfile(TrigramProfile &trigramProfile)
 {
+    TraceSpan span("normalizeTrigramProfile");
+
     float norma = 0.0;
     for (auto& i : trigramProfile)
     {
@@ -64,7 +112,7 @@ void normalizeTrigramProfile(TrigramProfile &trigramProfile)
         norma += (adder * adder);
     }
 
-    norma = std::sqrtf(norma);
+    norma = std::sqrt(norma);
 
     for (auto &i : trigramProfile)
     {
@@ -96,16 +144,119 @@ float getCosineSimilarity(TrigramProfile &textProfile, TrigramProfile &languageP
     return result;
 }
 
+/**
+ * @brief Hashes the trigrams of a profile, once for all languages.
+ *
+ * @param trigramProfile The trigram profile
+ * @param trigramHashes Destination hashes, in map order
+ */
+void getTrigramHashes(const TrigramProfile &trigramProfile, TrigramHashes &trigramHashes)
+{
+    trigramHashes.clear();
+    trigramHashes.reserve(trigramProfile.size());
+
+    for (auto &entry : trigramProfile)
+        trigramHashes.push_back(getHash64(entry.first));
+}
+
+/**
+ * @brief Calculates the cosine similarity between a text trigram profile and
+ * a language, skipping trigrams the language's filter rules out.
+ *
+ * @param textProfile The text trigram profile
+ * @param textHashes The text trigram hashes, from getTrigramHashes()
+ * @param language The language
+ * @param stats Filter counters, added to
+ * @return float The cosine similarity score
+ */
+float getCosineSimilarity(TrigramProfile &textProfile, const TrigramHashes &textHashes,
+                          LanguageProfile &language, TrigramFilterStats &stats)
+{
+    float result = 0;
+
+    auto textHash = textHashes.begin();
+    for (auto &textIt : textProfile)
+    {
+        if (!language.trigramFilter.mightContain(*textHash++))
+        {
+            stats.skippedLookups++;
+            continue;
+        }
+
+        auto langIt = language.trigramProfile.find(textIt.first);
+        if (langIt != language.trigramProfile.end())
+            result += (langIt->second * textIt.second);
+        else
+            stats.falsePositives++;
+    }
+    stats.lookups += textProfile.size();
+
+    return result;
+}
+
+/**
+ * @brief Builds the trigram filter of a language from its profile.
+ *
+ * @param language The language
+ */
+void buildTrigramFilter(LanguageProfile &language)
+{
+    language.trigramFilter.build(language.trigramProfile.size());
+
+    for (auto &entry : language.trigramProfile)
+        language.trigramFilter.insert(getHash64(entry.first));
+}
+
+/**
+ * @brief Adds counters gathered by one identification to the process-wide
+ * trigram filter counters.
+ *
+ * @param stats The counters
+ */
+void addTrigramFilterStats(const TrigramFilterStats &stats)
+{
+    trigramLookups.fetch_add(stats.lookups, memory_order_relaxed);
+    skippedTrigramLookups.fetch_add(stats.skippedLookups, memory_order_relaxed);
+    trigramFalsePositives.fetch_add(stats.falsePositives, memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the trigram filter counters.
+ */
+TrigramFilterStats getTrigramFilterStats()
+{
+    TrigramFilterStats stats;
+    stats.lookups = trigramLookups.load(memory_order_relaxed);
+    stats.skippedLookups = skippedTrigramLookups.load(memory_order_relaxed);
+    stats.falsePositives = trigramFalsePositives.load(memory_order_relaxed);
+
+    return stats;
+}
+
+/**
+ * @brief Zeroes the trigram filter counters.
+ */
+void resetTrigramFilterStats()
+{
+    trigramLookups = 0;
+    skippedTrigramLookups = 0;
+    trigramFalsePositives = 0;
+}
+
 /**
  * @brief Identifies the language of a text.
  *
  * @param text A Text (vector of lines)
  * @param languages A list of Language objects
+ * @param progress Optional progress counters and cancellation flag
  * @return string The language code of the most likely language
  */
-string identifyLanguage(const Text& text, LanguageProfiles& languages)
+string identifyLanguage(const Text& text, LanguageProfiles& languages, IdentificationProgress *progress)
 {
-    TrigramProfile trig_prof = buildTrigramProfile(text);
+    if (progress)
+        progress->total.store(text.size() + languages.size(), memory_order_relaxed);
+
+    TrigramProfile trig_prof = buildTrigramProfile(text, progress);
     TrigramProfile& ref_trig_prof = trig_prof;
     if (trig_prof.empty() || languages.empty())
     {
@@ -113,19 +264,38 @@ string identifyLanguage(const Text& text, LanguageProfiles& languages)
     }
     normalizeTrigramProfile(ref_trig_prof);
 
+    TraceSpan span("score (map)");
+    TrigramHashes textHashes;
+    getTrigramHashes(ref_trig_prof, textHashes);
+    TrigramFilterStats stats = {0, 0, 0};
+
     float max = 0.0f;
     std::string lan_identified;
     float n;
     for (auto& lan : languages)         //recorre todos los lenguajes
     {
+        if (progress)
+        {
+            if (progress->cancelled.load(memory_order_relaxed))
+            {
+                addTrigramFilterStats(stats);
+                return "";
+            }
+            progress->current.fetch_add(1, memory_order_relaxed);
+        }
+
         if (lan.trigramProfile.empty()) continue;
-        n = getCosineSimilarity(ref_trig_prof, lan.trigramProfile);
+        n = getCosineSimilarity(ref_trig_prof, textHashes, lan, stats);
         if (n > max)                   //busca cual lenguaje tiene la mayor similitud coseno 
         {
             max = n;
             lan_identified = lan.languageCode;
         }
     }
+
+    // Published once, so concurrent identifications do not contend
+    addTrigramFilterStats(stats);
+
     return lan_identified;
 }
 
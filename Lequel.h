@@ -10,15 +10,24 @@
 #ifndef LEQUEL_H
 #define LEQUEL_H
 
+#include <atomic>
+#include <cstdint>
 #include <list>
 #include <map>
 #include <string>
+#include <vector>
 
+#include "BloomFilter.h"
+#include "CountMinSketch.h"
 #include "Text.h"
 
 // TrigramProfile: map of trigram -> frequency
 typedef std::map<std::string, float> TrigramProfile;
 
+// TrigramHashes: getHash64() of each trigram of a TrigramProfile, in map
+// order
+typedef std::vector<uint64_t> TrigramHashes;
+
 // TrigramList: list of trigrams
 typedef std::list<std::string> TrigramList;
 
@@ -26,14 +35,49 @@ struct LanguageProfile
 {
     std::string languageCode;
     TrigramProfile trigramProfile;
+
+    // Filter of trigram hashes, checked before trigramProfile.find()
+    BloomFilter trigramFilter;
 };
 
 typedef std::list<LanguageProfile> LanguageProfiles;
 
+// IdentificationProgress: progress counters and cancellation flag, shared
+// between an identification running on a worker thread and the UI thread
+struct IdentificationProgress
+{
+    std::atomic<size_t> current{0};
+    std::atomic<size_t> total{0};
+    std::atomic<bool> cancelled{false};
+};
+
+// TrigramFilterStats: counters of trigram lookups in language profiles.
+// skippedLookups / lookups is the fraction of lookups the filters saved, and
+// falsePositives / (falsePositives + skippedLookups) the measured false
+// positive rate.
+struct TrigramFilterStats
+{
+    uint64_t lookups;
+    uint64_t skippedLookups;
+    uint64_t falsePositives;
+};
+
 // Functions
-TrigramProfile buildTrigramProfile(const Text &text);
+TrigramProfile buildTrigramProfile(const Text &text, IdentificationProgress *progress = nullptr,
+                                   bool skipNoise = false);
+bool buildTrigramProfile(const Text &text, CountMinSketch &sketch,
+                         IdentificationProgress *progress = nullptr, bool skipNoise = false);
+uint64_t getTrigramKeyHash(uint64_t trigramKey);
 void normalizeTrigramProfile(TrigramProfile &trigramProfile);
 float getCosineSimilarity(TrigramProfile &textProfile, TrigramProfile &languageProfile);
-std::string identifyLanguage(const Text &text, LanguageProfiles &languages);
+void getTrigramHashes(const TrigramProfile &trigramProfile, TrigramHashes &trigramHashes);
+float getCosineSimilarity(TrigramProfile &textProfile, const TrigramHashes &textHashes,
+                          LanguageProfile &language, TrigramFilterStats &stats);
+void buildTrigramFilter(LanguageProfile &language);
+void addTrigramFilterStats(const TrigramFilterStats &stats);
+TrigramFilterStats getTrigramFilterStats();
+void resetTrigramFilterStats();
+std::string identifyLanguage(const Text &text, LanguageProfiles &languages,
+                             IdentificationProgress *progress = nullptr);
 
 #endif
@@ -0,0 +1,148 @@
+/**
+ * @brief Lequel? memory accounting
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ *
+ * @cite https://sourceware.org/glibc/wiki/MallocInternals
+ */
+
+#include "MemoryAccounting.h"
+
+using namespace std;
+
+/**
+ * @brief Estimates the memory malloc() takes for a block.
+ *
+ * @param size The requested size
+ * @return size_t The block size, including malloc overhead
+ */
+size_t getHeapBlockSize(size_t size)
+{
+    if (!size)
+        return 0;
+
+    size_t blockSize = (size + MALLOC_OVERHEAD + MALLOC_ALIGNMENT - 1) & ~(MALLOC_ALIGNMENT - 1);
+
+    return blockSize < MALLOC_MIN_BLOCK_SIZE ? MALLOC_MIN_BLOCK_SIZE : blockSize;
+}
+
+/**
+ * @brief Estimates the heap memory of a string's characters (0 for short
+ * strings).
+ */
+size_t getStringHeapSize(const string &s)
+{
+    return s.capacity() > STRING_SSO_CAPACITY ? getHeapBlockSize(s.capacity() + 1) : 0;
+}
+
+/**
+ * @brief Estimates the heap memory of a vector's elements.
+ */
+template <typename T>
+static size_t getVectorHeapSize(const vector<T> &v)
+{
+    return getHeapBlockSize(v.capacity() * sizeof(T));
+}
+
+/**
+ * @brief Estimates the memory of a trigram profile: one heap node per
+ * trigram, with its key characters if they do not fit in the string.
+ *
+ * @param trigramProfile The trigram profile
+ * @return size_t The byte size
+ */
+size_t getTrigramProfileByteSize(const TrigramProfile &trigramProfile)
+{
+    size_t nodeSize = getHeapBlockSize(MAP_NODE_HEADER_SIZE + sizeof(TrigramProfile::value_type));
+
+    size_t byteSize = sizeof(TrigramProfile);
+    for (auto &entry : trigramProfile)
+        byteSize += nodeSize + getStringHeapSize(entry.first);
+
+    return byteSize;
+}
+
+/**
+ * @brief Estimates the memory of a trigram id profile.
+ *
+ * @param trigramIdProfile The trigram id profile
+ * @return size_t The byte size
+ */
+size_t getTrigramIdProfileByteSize(const TrigramIdProfile &trigramIdProfile)
+{
+    return sizeof(TrigramIdProfile) + getVectorHeapSize(trigramIdProfile);
+}
+
+/**
+ * @brief Estimates the memory of a language model: its id profiles,
+ * vocabulary, rows and bounds.
+ *
+ * @param model The language model
+ * @return size_t The byte size
+ */
+size_t getLanguageModelByteSize(const LanguageModel &model)
+{
+    size_t byteSize = getVectorHeapSize(model.languageProfiles) + model.vocabulary.getByteSize() +
+                      getVectorHeapSize(model.trigramHashes) + getVectorHeapSize(model.weights) +
+                      getVectorHeapSize(model.maxWeights) + getVectorHeapSize(model.trigramMaxWeights) +
+                      getVectorHeapSize(model.languageCodes);
+    for (auto &languageProfile : model.languageProfiles)
+        byteSize += getTrigramIdProfileByteSize(languageProfile);
+    for (auto &languageCode : model.languageCodes)
+        byteSize += getStringHeapSize(languageCode);
+
+    return byteSize;
+}
+
+/**
+ * @brief Reports the memory of the loaded model, by structure and by
+ * language.
+ *
+ * By language, the bytes are those of the language's TrigramProfile map,
+ * Bloom filter and TrigramIdProfile.
+ *
+ * @param languages The language profiles
+ * @param model The language model
+ * @param structures Destination bytes by structure
+ * @param languageBytes Destination bytes by language code
+ */
+void getModelMemoryReport(const LanguageProfiles &languages, const LanguageModel &model,
+                          MemoryReport &structures, MemoryReport &languageBytes)
+{
+    structures.clear();
+    languageBytes.clear();
+
+    size_t mapBytes = 0;
+    size_t filterBytes = 0;
+    size_t idProfileBytes = 0;
+    auto idProfile = model.languageProfiles.begin();
+    for (auto &language : languages)
+    {
+        size_t languageMapBytes = getTrigramProfileByteSize(language.trigramProfile);
+        size_t languageFilterBytes = getHeapBlockSize(language.trigramFilter.getByteSize());
+        size_t languageIdProfileBytes = 0;
+        if (idProfile != model.languageProfiles.end())
+            languageIdProfileBytes = getTrigramIdProfileByteSize(*idProfile++);
+
+        mapBytes += languageMapBytes;
+        filterBytes += languageFilterBytes;
+        idProfileBytes += languageIdProfileBytes;
+        languageBytes.push_back({language.languageCode,
+                                 languageMapBytes + languageFilterBytes + languageIdProfileBytes});
+    }
+
+    size_t languageCodeBytes = getVectorHeapSize(model.languageCodes);
+    for (auto &languageCode : model.languageCodes)
+        languageCodeBytes += getStringHeapSize(languageCode);
+
+    structures.push_back({"TrigramProfile maps", mapBytes});
+    structures.push_back({"Bloom filters", filterBytes});
+    structures.push_back({"TrigramIdProfiles", idProfileBytes + getVectorHeapSize(model.languageProfiles)});
+    structures.push_back({"vocabulary", model.vocabulary.getByteSize()});
+    structures.push_back({"trigram hashes", getVectorHeapSize(model.trigramHashes)});
+    structures.push_back({"weight rows", getVectorHeapSize(model.weights)});
+    structures.push_back({"max weights", getVectorHeapSize(model.maxWeights) +
+                                             getVectorHeapSize(model.trigramMaxWeights)});
+    structures.push_back({"language codes", languageCodeBytes});
+}
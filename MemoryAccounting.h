@@ -0,0 +1,49 @@
+/**
+ * @brief Lequel? memory accounting
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "LanguageModel.h"
+#include "Lequel.h"
+
+// Heap block estimates (glibc malloc on 64-bit): each block carries a size
+// word, is rounded up to 16 bytes, and takes at least 32 bytes
+const size_t MALLOC_OVERHEAD = sizeof(size_t);
+const size_t MALLOC_ALIGNMENT = 16;
+const size_t MALLOC_MIN_BLOCK_SIZE = 32;
+
+// Node header of std::map (color and parent, left and right pointers)
+const size_t MAP_NODE_HEADER_SIZE = 4 * sizeof(void *);
+
+// Short strings are stored inside std::string itself, off the heap
+const size_t STRING_SSO_CAPACITY = 15;
+
+// MemoryReport: (name, bytes) lines, by structure or by language
+struct MemoryReportEntry
+{
+    std::string name;
+    size_t bytes;
+};
+
+typedef std::vector<MemoryReportEntry> MemoryReport;
+
+// Functions
+size_t getHeapBlockSize(size_t size);
+size_t getStringHeapSize(const std::string &s);
+size_t getTrigramProfileByteSize(const TrigramProfile &trigramProfile);
+size_t getTrigramIdProfileByteSize(const TrigramIdProfile &trigramIdProfile);
+size_t getLanguageModelByteSize(const LanguageModel &model);
+void getModelMemoryReport(const LanguageProfiles &languages, const LanguageModel &model,
+                          MemoryReport &structures, MemoryReport &languageBytes);
+
+#endif
@@ -0,0 +1,560 @@
+/**
+ * @brief Lequel? n-gram profiles specialized by n-gram order at compile time
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef NGRAMPROFILE_H
+#define NGRAMPROFILE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "CSVData.h"
+#include "CaseFolding.h"
+#include "Lequel.h"
+#include "NoiseFilter.h"
+#include "SimdKernels.h"
+
+// Bits per code point in a packed n-gram key (Unicode needs 21)
+const int NGRAM_CODEPOINT_BITS = 21;
+const uint32_t NGRAM_CODEPOINT_MASK = (1U << NGRAM_CODEPOINT_BITS) - 1;
+
+// PackedKey128: key for n-grams wider than 64 bits (N = 4, 5)
+struct PackedKey128
+{
+    uint64_t high;
+    uint64_t low;
+
+    bool operator==(const PackedKey128 &other) const
+    {
+        return (high == other.high) && (low == other.low);
+    }
+    bool operator<(const PackedKey128 &other) const
+    {
+        return (high < other.high) || ((high == other.high) && (low < other.low));
+    }
+};
+
+// NgramKey<N>: smallest key that packs N code points
+template <int N>
+struct NgramKey
+{
+    static_assert((N >= 4) && (N <= 5), "n-gram order must be 1..5");
+    typedef PackedKey128 Type;
+};
+template <>
+struct NgramKey<1>
+{
+    typedef uint32_t Type;
+};
+template <>
+struct NgramKey<2>
+{
+    typedef uint64_t Type;
+};
+template <>
+struct NgramKey<3>
+{
+    typedef uint64_t Type;
+};
+
+// NgramKeyOps<N, Key>: sliding-window operations on a packed key. The oldest
+// code point sits in the most significant bits.
+template <int N, typename Key>
+struct NgramKeyOps
+{
+    static Key push(Key key, char32_t c)
+    {
+        const Key mask = ((Key)1 << (N * NGRAM_CODEPOINT_BITS)) - 1;
+        return ((key << NGRAM_CODEPOINT_BITS) | c) & mask;
+    }
+
+    static char32_t get(Key key, int i)
+    {
+        return (char32_t)((key >> ((N - 1 - i) * NGRAM_CODEPOINT_BITS)) & NGRAM_CODEPOINT_MASK);
+    }
+
+    static size_t hash(Key key)
+    {
+        uint64_t x = (uint64_t)key * 0x9e3779b97f4a7c15ULL;
+        return (size_t)(x ^ (x >> 32));
+    }
+};
+
+template <int N>
+struct NgramKeyOps<N, PackedKey128>
+{
+    static PackedKey128 push(PackedKey128 key, char32_t c)
+    {
+        const uint64_t highMask = (1ULL << (N * NGRAM_CODEPOINT_BITS - 64)) - 1;
+        PackedKey128 result;
+        result.high = ((key.high << NGRAM_CODEPOINT_BITS) | (key.low >> (64 - NGRAM_CODEPOINT_BITS))) & highMask;
+        result.low = (key.low << NGRAM_CODEPOINT_BITS) | c;
+        return result;
+    }
+
+    static char32_t get(PackedKey128 key, int i)
+    {
+        int shift = (N - 1 - i) * NGRAM_CODEPOINT_BITS;
+        uint64_t bits;
+        if (shift >= 64)
+            bits = key.high >> (shift - 64);
+        else if (shift + NGRAM_CODEPOINT_BITS <= 64)
+            bits = key.low >> shift;
+        else
+            bits = (key.low >> shift) | (key.high << (64 - shift));
+        return (char32_t)(bits & NGRAM_CODEPOINT_MASK);
+    }
+
+    static size_t hash(PackedKey128 key)
+    {
+        uint64_t x = (key.low ^ (key.high * 0xc2b2ae3d27d4eb4fULL)) * 0x9e3779b97f4a7c15ULL;
+        return (size_t)(x ^ (x >> 32));
+    }
+};
+
+template <int N>
+struct NgramKeyHash
+{
+    size_t operator()(typename NgramKey<N>::Type key) const
+    {
+        return NgramKeyOps<N, typename NgramKey<N>::Type>::hash(key);
+    }
+};
+
+// NgramProfile<N>: map of packed n-gram -> frequency
+template <int N>
+using NgramProfile = std::unordered_map<typename NgramKey<N>::Type, float, NgramKeyHash<N>>;
+
+// NgramModel<N>: dense n-gram-major weight matrix, like LanguageModel
+template <int N>
+struct NgramModel
+{
+    std::vector<std::string> languageCodes;
+    std::unordered_map<typename NgramKey<N>::Type, uint32_t, NgramKeyHash<N>> ngramIds;
+
+    size_t rowSize;
+    std::vector<float> weights;
+
+    const float *getRow(uint32_t ngramId) const
+    {
+        return &weights[ngramId * rowSize];
+    }
+};
+
+/**
+ * @brief Calls f(key) for every n-gram of a line, in order.
+ *
+ * The line is decoded from UTF-8 and case folded as the window slides,
+ * with no copy.
+ * N-grams do not include the line's trailing '\r'.
+ *
+ * @param line The line, encoded as UTF-8
+ * @param f Callback taking the packed n-gram key
+ */
+template <int N, typename Function>
+inline void forEachNgram(const std::string &line, Function f)
+{
+    typedef typename NgramKey<N>::Type Key;
+
+    size_t size = line.size();
+    if (size && (line[size - 1] == '\r'))
+        size--;
+
+    Key key = Key();
+    int codePointNum = 0;
+    for (size_t position = 0; position < size;)
+    {
+        char32_t c = (unsigned char)line[position];
+        if (c < 0x80)
+            position++;
+        else
+            c = getNextUTF8(line, position);
+
+        key = NgramKeyOps<N, Key>::push(key, foldCase(c));
+        if (codePointNum < N - 1)
+            codePointNum++;
+        else
+            f(key);
+    }
+}
+
+/**
+ * @brief Calls f(key) for every n-gram of a line, skipping noise spans.
+ *
+ * Each skipped span reads as a single space, so no n-gram joins the words
+ * around it, and no double spaces appear.
+ *
+ * @param line The line, encoded as UTF-8
+ * @param noiseSpans Spans to skip, from findNoiseSpans()
+ * @param f Callback taking the packed n-gram key
+ */
+template <int N, typename Function>
+inline void forEachNgram(const std::string &line, const NoiseSpans &noiseSpans, Function f)
+{
+    typedef typename NgramKey<N>::Type Key;
+
+    if (noiseSpans.empty())
+    {
+        forEachNgram<N>(line, f);
+        return;
+    }
+
+    size_t size = line.size();
+    if (size && (line[size - 1] == '\r'))
+        size--;
+
+    Key key = Key();
+    int codePointNum = 0;
+    char32_t lastCodePoint = ' ';
+    auto push = [&](char32_t c)
+    {
+        key = NgramKeyOps<N, Key>::push(key, c);
+        lastCodePoint = c;
+        if (codePointNum < N - 1)
+            codePointNum++;
+        else
+            f(key);
+    };
+
+    // Segments between spans
+    size_t position = 0;
+    for (size_t spanIndex = 0; spanIndex <= noiseSpans.size(); spanIndex++)
+    {
+        size_t end = spanIndex < noiseSpans.size() ? std::min(noiseSpans[spanIndex].first, size) : size;
+
+        // Spaces around a span collapse into one
+        if (spanIndex)
+        {
+            while ((position < end) && (line[position] == ' '))
+                position++;
+            if ((position < end) && (lastCodePoint != ' '))
+                push(' ');
+        }
+
+        while (position < end)
+        {
+            char32_t c = (unsigned char)line[position];
+            if (c < 0x80)
+                position++;
+            else
+                c = getNextUTF8(line, position);
+
+            push(foldCase(c));
+        }
+
+        if (spanIndex < noiseSpans.size())
+            position = std::max(position, noiseSpans[spanIndex].second);
+    }
+}
+
+/**
+ * @brief Builds an n-gram profile from a given text.
+ *
+ * @param text Vector of lines (Text)
+ * @param ngramProfile Destination profile (counts are added)
+ * @param progress Optional progress counters, advanced once per line
+ * @param skipNoise Skip markup, URLs and numbers (see findNoiseSpans())
+ * @return true Succeeded
+ * @return false Cancelled
+ */
+template <int N>
+bool buildNgramProfile(const Text &text, NgramProfile<N> &ngramProfile,
+                       IdentificationProgress *progress = nullptr, bool skipNoise = false)
+{
+    NoiseSpans noiseSpans;
+
+    for (auto &line : text)
+    {
+        if (progress)
+        {
+            if (progress->cancelled.load(std::memory_order_relaxed))
+                return false;
+            progress->current.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (skipNoise)
+            findNoiseSpans(line, line.size(), noiseSpans);
+        forEachNgram<N>(line, noiseSpans, [&ngramProfile](typename NgramKey<N>::Type key)
+                        { ngramProfile[key] += 1.0f; });
+    }
+
+    return true;
+}
+
+/**
+ * @brief Normalizes an n-gram profile.
+ *
+ * @param ngramProfile The n-gram profile.
+ */
+template <int N>
+void normalizeNgramProfile(NgramProfile<N> &ngramProfile)
+{
+    float norm = 0.0f;
+    for (auto &entry : ngramProfile)
+        norm += entry.second * entry.second;
+
+    norm = std::sqrt(norm);
+    if (norm == 0.0f)
+        return;
+
+    for (auto &entry : ngramProfile)
+        entry.second /= norm;
+}
+
+/**
+ * @brief Converts a packed n-gram to UTF-8.
+ */
+template <int N>
+std::string getNgramString(typename NgramKey<N>::Type key)
+{
+    std::string s;
+    for (int i = 0; i < N; i++)
+        appendUTF8(s, NgramKeyOps<N, typename NgramKey<N>::Type>::get(key, i));
+
+    return s;
+}
+
+/**
+ * @brief Packs a UTF-8 n-gram.
+ *
+ * @param s The n-gram
+ * @param key Destination key
+ * @return true s has exactly N code points
+ * @return false s is not an n-gram of order N
+ */
+template <int N>
+bool getNgramKey(const std::string &s, typename NgramKey<N>::Type &key)
+{
+    typedef typename NgramKey<N>::Type Key;
+
+    key = Key();
+    int codePointNum = 0;
+    for (size_t position = 0; position < s.size(); codePointNum++)
+    {
+        if (codePointNum == N)
+            return false;
+
+        key = NgramKeyOps<N, Key>::push(key, getNextUTF8(s, position));
+    }
+
+    return codePointNum == N;
+}
+
+/**
+ * @brief Derives a lower-order profile from a trigram profile.
+ *
+ * Each trigram adds its frequency to the n-grams it contains, which
+ * approximates the n-gram counts of the text the trigrams came from.
+ *
+ * @param trigramProfile The trigram profile
+ * @param ngramProfile Destination profile
+ */
+template <int N>
+void deriveNgramProfile(const TrigramProfile &trigramProfile, NgramProfile<N> &ngramProfile)
+{
+    static_assert(N <= 3, "only lower orders can be derived from trigrams");
+
+    for (auto &entry : trigramProfile)
+    {
+        float frequency = entry.second;
+        forEachNgram<N>(entry.first, [&ngramProfile, frequency](typename NgramKey<N>::Type key)
+                        { ngramProfile[key] += frequency; });
+    }
+}
+
+/**
+ * @brief Trains an n-gram profile from a corpus.
+ *
+ * Keeps the maxNgramNum most frequent n-grams, as raw counts, like the
+ * trigram CSV files in resources/trigrams.
+ *
+ * @param corpus The corpus
+ * @param maxNgramNum Maximum number of n-grams to keep
+ * @param ngramProfile Destination profile
+ */
+template <int N>
+void trainNgramProfile(const Text &corpus, size_t maxNgramNum, NgramProfile<N> &ngramProfile)
+{
+    typedef typename NgramKey<N>::Type Key;
+
+    NgramProfile<N> counts;
+    buildNgramProfile<N>(corpus, counts);
+
+    std::vector<std::pair<float, Key>> sortedCounts;
+    for (auto &entry : counts)
+        sortedCounts.push_back(std::make_pair(entry.second, entry.first));
+
+    size_t keptNum = std::min(maxNgramNum, sortedCounts.size());
+    std::partial_sort(sortedCounts.begin(), sortedCounts.begin() + keptNum, sortedCounts.end(),
+                      [](const std::pair<float, Key> &a, const std::pair<float, Key> &b)
+                      { return (a.first > b.first) || ((a.first == b.first) && (a.second < b.second)); });
+
+    ngramProfile.clear();
+    for (size_t i = 0; i < keptNum; i++)
+        ngramProfile[sortedCounts[i].second] = sortedCounts[i].first;
+}
+
+/**
+ * @brief Reads an n-gram profile from a CSV file of (n-gram, count) rows.
+ *
+ * @param path The filename
+ * @param ngramProfile Destination profile (not normalized)
+ * @return true Succeeded
+ * @return false Failed
+ */
+template <int N>
+bool readNgramProfile(const std::string &path, NgramProfile<N> &ngramProfile)
+{
+    CSVData data;
+    if (!readCSV(path, data))
+        return false;
+
+    ngramProfile.clear();
+    for (auto &fields : data)
+    {
+        // Malformed rows are skipped
+        typename NgramKey<N>::Type key;
+        if ((fields.size() != 2) || !getNgramKey<N>(fields[0], key))
+            continue;
+
+        char *end;
+        double count = std::strtod(fields[1].c_str(), &end);
+        if (fields[1].empty() || *end || !(count > 0))
+            continue;
+
+        ngramProfile[key] = (float)count;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Writes an n-gram profile to a CSV file, most frequent first.
+ *
+ * @param path The filename
+ * @param ngramProfile The profile
+ * @return true Succeeded
+ * @return false Failed
+ */
+template <int N>
+bool writeNgramProfile(const std::string &path, const NgramProfile<N> &ngramProfile)
+{
+    std::vector<std::pair<float, std::string>> rows;
+    for (auto &entry : ngramProfile)
+        rows.push_back(std::make_pair(entry.second, getNgramString<N>(entry.first)));
+
+    std::sort(rows.begin(), rows.end(),
+              [](const std::pair<float, std::string> &a, const std::pair<float, std::string> &b)
+              { return (a.first > b.first) || ((a.first == b.first) && (a.second < b.second)); });
+
+    CSVData data;
+    for (auto &row : rows)
+        data.push_back({row.second, std::to_string((long long)row.first)});
+
+    return writeCSV(path, data);
+}
+
+/**
+ * @brief Builds the dense model from normalized n-gram profiles.
+ *
+ * @param languageCodes Language code of each profile
+ * @param ngramProfiles The profiles
+ * @param model Destination model
+ */
+template <int N>
+void buildNgramModel(const std::vector<std::string> &languageCodes,
+                     const std::vector<NgramProfile<N>> &ngramProfiles, NgramModel<N> &model)
+{
+    model.languageCodes = languageCodes;
+    model.ngramIds.clear();
+
+    for (auto &ngramProfile : ngramProfiles)
+    {
+        for (auto &entry : ngramProfile)
+            model.ngramIds.insert(std::make_pair(entry.first, (uint32_t)model.ngramIds.size()));
+    }
+
+    model.rowSize = (languageCodes.size() + SIMD_ROW_ALIGNMENT - 1) / SIMD_ROW_ALIGNMENT * SIMD_ROW_ALIGNMENT;
+    model.weights.assign(model.ngramIds.size() * model.rowSize, 0.0f);
+
+    for (size_t i = 0; i < ngramProfiles.size(); i++)
+    {
+        for (auto &entry : ngramProfiles[i])
+            model.weights[model.ngramIds[entry.first] * model.rowSize + i] = entry.second;
+    }
+}
+
+/**
+ * @brief Builds an n-gram model from the trigram language profiles.
+ *
+ * N = 3 packs the trigrams as they are; N < 3 derives the lower-order
+ * profiles with deriveNgramProfile().
+ *
+ * @param languages The trigram profiles
+ * @param model Destination model
+ */
+template <int N>
+void buildNgramModel(const LanguageProfiles &languages, NgramModel<N> &model)
+{
+    std::vector<std::string> languageCodes;
+    std::vector<NgramProfile<N>> ngramProfiles;
+    for (auto &language : languages)
+    {
+        languageCodes.push_back(language.languageCode);
+        ngramProfiles.push_back(NgramProfile<N>());
+        deriveNgramProfile<N>(language.trigramProfile, ngramProfiles.back());
+        normalizeNgramProfile<N>(ngramProfiles.back());
+    }
+
+    buildNgramModel<N>(languageCodes, ngramProfiles, model);
+}
+
+/**
+ * @brief Identifies the language of a text with an n-gram model.
+ *
+ * @param text A Text (vector of lines)
+ * @param model The n-gram model
+ * @param skipNoise Skip markup, URLs and numbers (see findNoiseSpans())
+ * @return string The language code of the most likely language
+ */
+template <int N>
+std::string identifyLanguage(const Text &text, const NgramModel<N> &model, bool skipNoise = false)
+{
+    NgramProfile<N> textProfile;
+    buildNgramProfile<N>(text, textProfile, nullptr, skipNoise);
+    if (textProfile.empty() || model.languageCodes.empty())
+        return "";
+    normalizeNgramProfile<N>(textProfile);
+
+    std::vector<float> scores(model.rowSize, 0.0f);
+    for (auto &entry : textProfile)
+    {
+        auto it = model.ngramIds.find(entry.first);
+        if (it != model.ngramIds.end())
+            accumulateRow(model.getRow(it->second), entry.second, scores.data(), model.rowSize);
+    }
+
+    float max = 0.0f;
+    std::string languageCode;
+    for (size_t i = 0; i < model.languageCodes.size(); i++)
+    {
+        if (scores[i] > max)
+        {
+            max = scores[i];
+            languageCode = model.languageCodes[i];
+        }
+    }
+
+    return languageCode;
+}
+
+#endif
@@ -0,0 +1,269 @@
+/**
+ * @brief Lequel? skipping of markup, URLs and numbers in text
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include <cstring>
+
+#include "NoiseFilter.h"
+#include "SimdKernels.h"
+
+using namespace std;
+
+static bool isAsciiLetter(char c)
+{
+    return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z'));
+}
+
+static bool isAsciiDigit(char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+static bool isAsciiAlnum(char c)
+{
+    return isAsciiLetter(c) || isAsciiDigit(c);
+}
+
+static bool isOneOf(char c, const char *characters)
+{
+    return c && strchr(characters, c);
+}
+
+/**
+ * @brief Whether a URL or e-mail address ends before a byte.
+ */
+static bool isAddressEnd(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '<') || (c == '>') || (c == '"') || (c == '\'') ||
+           (c == '(') || (c == ')');
+}
+
+/**
+ * @brief Finds the end of an address from a position.
+ *
+ * Trailing punctuation is left out, as it likely ends the sentence.
+ */
+static size_t findAddressEnd(const string &line, size_t position, size_t size)
+{
+    while ((position < size) && !isAddressEnd(line[position]))
+        position++;
+
+    while ((position > 0) && isOneOf(line[position - 1], ".,;:!?"))
+        position--;
+
+    return position;
+}
+
+/**
+ * @brief Matches an HTML tag or comment ("<p class=x>", "</b>", "<!-- -->")
+ * starting at a '<'.
+ */
+static size_t matchTag(const string &line, size_t position, size_t size)
+{
+    if ((position + 1 >= size) ||
+        !(isAsciiLetter(line[position + 1]) || isOneOf(line[position + 1], "/!?")))
+        return 0;
+
+    const void *tagEnd = memchr(line.data() + position + 1, '>', size - position - 1);
+
+    return tagEnd ? (const char *)tagEnd - line.data() + 1 : 0;
+}
+
+/**
+ * @brief Matches an HTML entity ("&amp;", "&#233;", "&#xE9;") starting at an
+ * '&'.
+ */
+static size_t matchEntity(const string &line, size_t position, size_t size)
+{
+    size_t end = position + 1;
+    if ((end < size) && (line[end] == '#'))
+    {
+        end++;
+        bool isHex = (end < size) && ((line[end] == 'x') || (line[end] == 'X'));
+        if (isHex)
+            end++;
+        size_t digitsBegin = end;
+        while ((end < size) && (isAsciiDigit(line[end]) || (isHex && isOneOf(line[end], "abcdefABCDEF"))))
+            end++;
+        if (end == digitsBegin)
+            return 0;
+    }
+    else
+    {
+        while ((end < size) && (end - position - 1 < NOISE_MAX_ENTITY_SIZE) && isAsciiAlnum(line[end]))
+            end++;
+        if (end - position - 1 < 2)
+            return 0;
+    }
+
+    return ((end < size) && (line[end] == ';')) ? end + 1 : 0;
+}
+
+/**
+ * @brief Matches a URL with a scheme ("https://...") around a ':'.
+ */
+static size_t matchSchemeUrl(const string &line, size_t position, size_t size, size_t &begin)
+{
+    if ((position + 2 >= size) || (line[position + 1] != '/') || (line[position + 2] != '/'))
+        return 0;
+
+    begin = position;
+    while ((begin > 0) && (isAsciiAlnum(line[begin - 1]) || isOneOf(line[begin - 1], "+-.")))
+        begin--;
+    if ((begin == position) || !isAsciiLetter(line[begin]))
+        return 0;
+
+    return findAddressEnd(line, position + 3, size);
+}
+
+/**
+ * @brief Matches a URL without a scheme ("www.example.com") around the '.'
+ * after "www".
+ */
+static size_t matchWwwUrl(const string &line, size_t position, size_t size, size_t &begin)
+{
+    if ((position < 3) || line.compare(position - 3, 3, "www") ||
+        ((position > 3) && isAsciiAlnum(line[position - 4])) ||
+        (position + 1 >= size) || !isAsciiAlnum(line[position + 1]))
+        return 0;
+
+    begin = position - 3;
+
+    return findAddressEnd(line, position + 1, size);
+}
+
+/**
+ * @brief Matches an e-mail address ("name@example.com") around an '@'.
+ */
+static size_t matchEmail(const string &line, size_t position, size_t size, size_t &begin)
+{
+    begin = position;
+    while ((begin > 0) && (isAsciiAlnum(line[begin - 1]) || isOneOf(line[begin - 1], "._%+-")))
+        begin--;
+    if (begin == position)
+        return 0;
+
+    // The domain needs a '.' followed by a letter
+    size_t end = position + 1;
+    bool hasDot = false;
+    while ((end < size) && (isAsciiAlnum(line[end]) || (line[end] == '-') ||
+                            ((line[end] == '.') && (end + 1 < size) && isAsciiAlnum(line[end + 1]))))
+    {
+        if ((line[end] == '.') && isAsciiLetter(line[end + 1]))
+            hasDot = true;
+        end++;
+    }
+
+    return hasDot ? end : 0;
+}
+
+/**
+ * @brief Matches a number or an id with digits ("2023", "1,234.5",
+ * "0x1f3a", "a3f9e2") around a digit: the whole alphanumeric token, with
+ * digit groups joined by ",.:/-".
+ */
+static size_t matchNumber(const string &line, size_t position, size_t size, size_t &begin)
+{
+    begin = position;
+    while ((begin > 0) && isAsciiAlnum(line[begin - 1]))
+        begin--;
+
+    size_t end = position;
+    while (end < size)
+    {
+        if (isAsciiAlnum(line[end]))
+            end++;
+        else if (isOneOf(line[end], ",.:/-") && (end + 1 < size) && isAsciiDigit(line[end + 1]))
+            end += 2;
+        else
+            break;
+    }
+
+    // Non-ASCII letters next to the token make it part of a word
+    if (((begin > 0) && ((unsigned char)line[begin - 1] >= 0x80)) ||
+        ((end < size) && ((unsigned char)line[end] >= 0x80)))
+        return 0;
+
+    return end;
+}
+
+/**
+ * @brief Adds a span, merging it with the previous one if they overlap.
+ */
+static void addNoiseSpan(size_t begin, size_t end, NoiseSpans &noiseSpans)
+{
+    if (!noiseSpans.empty() && (begin <= noiseSpans.back().second))
+    {
+        if (begin < noiseSpans.back().first)
+            noiseSpans.back().first = begin;
+        if (end > noiseSpans.back().second)
+            noiseSpans.back().second = end;
+    }
+    else
+        noiseSpans.push_back(make_pair(begin, end));
+}
+
+/**
+ * @brief Finds the spans of a line that carry no language signal: HTML tags
+ * and entities, URLs, e-mail addresses, and numbers and ids with digits.
+ *
+ * Candidate bytes are found with a vectorized scan, so plain text is
+ * skipped 16 or 32 bytes at a time; only candidates are matched.
+ *
+ * @param line The line, encoded as UTF-8
+ * @param size Bytes of the line to scan
+ * @param noiseSpans Destination spans
+ */
+void findNoiseSpans(const string &line, size_t size, NoiseSpans &noiseSpans)
+{
+    noiseSpans.clear();
+
+    size_t position = 0;
+    while (true)
+    {
+        position += findNoiseCandidate(line.data() + position, size - position);
+        if (position >= size)
+            break;
+
+        size_t begin = position;
+        size_t end = 0;
+        switch (line[position])
+        {
+        case '<':
+            end = matchTag(line, position, size);
+            break;
+        case '&':
+            end = matchEntity(line, position, size);
+            break;
+        case ':':
+            end = matchSchemeUrl(line, position, size, begin);
+            break;
+        case '.':
+            end = matchWwwUrl(line, position, size, begin);
+            break;
+        case '@':
+            end = matchEmail(line, position, size, begin);
+            break;
+        default:
+            end = matchNumber(line, position, size, begin);
+            break;
+        }
+
+        if (end > position)
+        {
+            addNoiseSpan(begin, end, noiseSpans);
+            position = end;
+        }
+        else if (isAsciiDigit(line[position]))
+        {
+            // The rest of the token would not match either
+            while ((position < size) && isAsciiAlnum(line[position]))
+                position++;
+        }
+        else
+            position++;
+    }
+}
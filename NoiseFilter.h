@@ -0,0 +1,26 @@
+/**
+ * @brief Lequel? skipping of markup, URLs and numbers in text
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef NOISEFILTER_H
+#define NOISEFILTER_H
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Longest HTML entity name skipped ("&thetasym;")
+const size_t NOISE_MAX_ENTITY_SIZE = 10;
+
+// NoiseSpans: byte ranges [first, second) of a line that carry no language
+// signal, sorted and disjoint
+typedef std::vector<std::pair<size_t, size_t>> NoiseSpans;
+
+// Functions
+void findNoiseSpans(const std::string &line, size_t size, NoiseSpans &noiseSpans);
+
+#endif
@@ -0,0 +1,136 @@
+/**
+ * @brief Lequel? hardware performance counters (Linux perf_event_open)
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ *
+ * @cite https://man7.org/linux/man-pages/man2/perf_event_open.2.html
+ */
+
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "PerfCounters.h"
+
+#ifdef __linux__
+// Event (type, config) of each PerfCounter
+static const struct
+{
+    uint32_t type;
+    uint64_t config;
+} PERF_EVENTS[PERF_COUNTER_NUM] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+#endif
+
+/**
+ * @brief Opens the counters, disabled.
+ */
+PerfCounters::PerfCounters()
+{
+    for (int i = 0; i < PERF_COUNTER_NUM; i++)
+    {
+        fds[i] = -1;
+        values[i] = 0;
+
+#ifdef __linux__
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_EVENTS[i].type;
+        attr.config = PERF_EVENTS[i].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+}
+
+/**
+ * @brief Closes the counters.
+ */
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (int i = 0; i < PERF_COUNTER_NUM; i++)
+    {
+        if (fds[i] >= 0)
+            close(fds[i]);
+    }
+#endif
+}
+
+/**
+ * @brief Resets and starts the counters.
+ */
+void PerfCounters::start()
+{
+#ifdef __linux__
+    for (int i = 0; i < PERF_COUNTER_NUM; i++)
+    {
+        if (fds[i] < 0)
+            continue;
+
+        ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+/**
+ * @brief Stops the counters and reads their values.
+ */
+void PerfCounters::stop()
+{
+#ifdef __linux__
+    for (int i = 0; i < PERF_COUNTER_NUM; i++)
+    {
+        if (fds[i] < 0)
+            continue;
+
+        ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i]))
+            values[i] = 0;
+    }
+#endif
+}
+
+/**
+ * @brief Whether the kernel allowed a counter.
+ */
+bool PerfCounters::isAvailable(PerfCounter counter) const
+{
+    return fds[counter] >= 0;
+}
+
+/**
+ * @brief Value of a counter between the last start() and stop().
+ */
+uint64_t PerfCounters::getValue(PerfCounter counter) const
+{
+    return values[counter];
+}
+
+/**
+ * @brief Short name of a counter.
+ */
+const char *PerfCounters::getName(PerfCounter counter)
+{
+    static const char *names[PERF_COUNTER_NUM] = {
+        "cycles", "instructions", "L1D misses", "LLC misses", "branch misses"};
+
+    return names[counter];
+}
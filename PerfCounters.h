@@ -0,0 +1,49 @@
+/**
+ * @brief Lequel? hardware performance counters (Linux perf_event_open)
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <cstdint>
+
+// PerfCounter: the counted hardware events
+enum PerfCounter
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_COUNTER_NUM
+};
+
+// PerfCounters: hardware counters of the calling thread. Counters the kernel
+// refuses (no PMU, as in most VMs, or perf_event_paranoid too high) are
+// left unavailable, and the others still count.
+class PerfCounters
+{
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    void start();
+    void stop();
+
+    bool isAvailable(PerfCounter counter) const;
+    uint64_t getValue(PerfCounter counter) const;
+
+    static const char *getName(PerfCounter counter);
+
+private:
+    int fds[PERF_COUNTER_NUM];
+    uint64_t values[PERF_COUNTER_NUM];
+};
+
+#endif
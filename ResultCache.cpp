@@ -0,0 +1,151 @@
+/**
+ * @brief Lequel? cache of identification results for repeated inputs
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include <algorithm>
+
+#include "Hash.h"
+#include "MemoryAccounting.h"
+#include "ResultCache.h"
+
+using namespace std;
+
+/**
+ * @brief Creates an empty cache.
+ *
+ * @param byteBudget Memory the entries may take, split evenly among shards
+ * (at least RESULT_CACHE_MIN_SHARD_BYTES each)
+ */
+ResultCache::ResultCache(size_t byteBudget)
+    : shardByteBudget(max(byteBudget / RESULT_CACHE_SHARD_NUM, RESULT_CACHE_MIN_SHARD_BYTES)),
+      shards(new Shard[RESULT_CACHE_SHARD_NUM])
+{
+}
+
+/**
+ * @brief Looks up the result for a text, making it the most recently used.
+ *
+ * @param textHash The text hash, from getTextHash()
+ * @param languageCode Destination language code
+ * @return true The text is cached
+ * @return false The text is not cached
+ */
+bool ResultCache::get(uint64_t textHash, string &languageCode)
+{
+    Shard &shard = getShard(textHash);
+    lock_guard<mutex> lock(shard.mutex);
+
+    auto i = shard.index.find(textHash);
+    if (i == shard.index.end())
+    {
+        shard.missNum++;
+        return false;
+    }
+
+    shard.entries.splice(shard.entries.begin(), shard.entries, i->second);
+    languageCode = i->second->languageCode;
+    shard.hitNum++;
+
+    return true;
+}
+
+/**
+ * @brief Caches the result for a text, evicting the least recently used
+ * results of its shard while over budget.
+ *
+ * @param textHash The text hash, from getTextHash()
+ * @param languageCode The language code
+ */
+void ResultCache::put(uint64_t textHash, const string &languageCode)
+{
+    Shard &shard = getShard(textHash);
+    lock_guard<mutex> lock(shard.mutex);
+
+    // Another thread may have identified the same text meanwhile
+    if (shard.index.count(textHash))
+        return;
+
+    shard.entries.push_front(Entry{textHash, languageCode});
+    shard.index[textHash] = shard.entries.begin();
+    shard.byteSize += getEntryByteSize(shard.entries.front());
+
+    while ((shard.byteSize > shardByteBudget) && !shard.entries.empty())
+    {
+        Entry &entry = shard.entries.back();
+        shard.byteSize -= getEntryByteSize(entry);
+        shard.index.erase(entry.textHash);
+        shard.entries.pop_back();
+        shard.evictionNum++;
+    }
+}
+
+/**
+ * @brief Sums the counters and contents of all shards.
+ */
+ResultCacheStats ResultCache::getStats() const
+{
+    ResultCacheStats stats = {0, 0, 0, 0, 0};
+    for (size_t i = 0; i < RESULT_CACHE_SHARD_NUM; i++)
+    {
+        const Shard &shard = shards[i];
+        lock_guard<mutex> lock(shard.mutex);
+
+        stats.hitNum += shard.hitNum;
+        stats.missNum += shard.missNum;
+        stats.evictionNum += shard.evictionNum;
+        stats.entryNum += shard.entries.size();
+        stats.byteSize += shard.byteSize;
+    }
+
+    return stats;
+}
+
+/**
+ * @brief The shard of a text. The top hash bits pick it, as the low bits
+ * pick the bucket inside the shard.
+ */
+ResultCache::Shard &ResultCache::getShard(uint64_t textHash)
+{
+    return shards[(textHash >> 32) & (RESULT_CACHE_SHARD_NUM - 1)];
+}
+
+/**
+ * @brief Estimates the memory of an entry: its list node, its index node and
+ * bucket, and its language code if it does not fit in the string.
+ */
+size_t ResultCache::getEntryByteSize(const Entry &entry)
+{
+    size_t listNodeSize = getHeapBlockSize(2 * sizeof(void *) + sizeof(Entry));
+    size_t indexNodeSize = getHeapBlockSize(sizeof(void *) + sizeof(uint64_t) +
+                                            sizeof(list<Entry>::iterator));
+
+    return listNodeSize + indexNodeSize + sizeof(void *) + getStringHeapSize(entry.languageCode);
+}
+
+/**
+ * @brief Hashes a text (xxHash64) as identification sees it: trailing '\r'
+ * and empty lines, which yield no trigrams, are left out.
+ *
+ * @param text The text
+ * @param seed Seed, to tell apart identification settings
+ * @return uint64_t The text hash
+ */
+uint64_t getTextHash(const Text &text, uint64_t seed)
+{
+    // Each line seeds the next, so line breaks count
+    uint64_t textHash = seed;
+    for (auto &line : text)
+    {
+        size_t size = line.size();
+        if (size && (line[size - 1] == '\r'))
+            size--;
+
+        if (size)
+            textHash = getHash64(line.data(), size, textHash);
+    }
+
+    return textHash;
+}
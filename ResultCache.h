@@ -0,0 +1,85 @@
+/**
+ * @brief Lequel? cache of identification results for repeated inputs
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Text.h"
+
+// Independent LRU shards, so threads rarely wait on the same lock (a power
+// of two)
+const size_t RESULT_CACHE_SHARD_NUM = 16;
+
+// Smallest byte budget of a shard: smaller budgets are raised to it, so an
+// entry never evicts itself
+const size_t RESULT_CACHE_MIN_SHARD_BYTES = 4 * 1024;
+
+// ResultCacheStats: lookups and contents of a cache since it was created
+struct ResultCacheStats
+{
+    uint64_t hitNum;
+    uint64_t missNum;
+    uint64_t evictionNum;
+    size_t entryNum;
+    size_t byteSize;
+
+    double getHitRate() const
+    {
+        return (hitNum + missNum) ? (double)hitNum / (hitNum + missNum) : 0.0;
+    }
+};
+
+// ResultCache: language codes of already identified texts, by text hash.
+// Each shard keeps its own least recently used order and a share of the byte
+// budget. Thread safe.
+class ResultCache
+{
+public:
+    ResultCache(size_t byteBudget);
+
+    bool get(uint64_t textHash, std::string &languageCode);
+    void put(uint64_t textHash, const std::string &languageCode);
+
+    ResultCacheStats getStats() const;
+
+private:
+    struct Entry
+    {
+        uint64_t textHash;
+        std::string languageCode;
+    };
+
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::list<Entry> entries;
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+        size_t byteSize = 0;
+        uint64_t hitNum = 0;
+        uint64_t missNum = 0;
+        uint64_t evictionNum = 0;
+    };
+
+    Shard &getShard(uint64_t textHash);
+    static size_t getEntryByteSize(const Entry &entry);
+
+    size_t shardByteBudget;
+    std::unique_ptr<Shard[]> shards;
+};
+
+// Functions
+uint64_t getTextHash(const Text &text, uint64_t seed = 0);
+
+#endif
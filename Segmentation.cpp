@@ -0,0 +1,190 @@
+/**
+ * @brief Lequel? language segmentation of mixed-language text
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include "CaseFolding.h"
+#include "Segmentation.h"
+#include "SimdKernels.h"
+
+using namespace std;
+
+/**
+ * @brief Splits a text in spans of the same language.
+ *
+ * A window of windowSize trigrams slides over the text. As a trigram enters
+ * or leaves the window, its model row is added to or subtracted from the
+ * window's dot product with every language, so the whole text is segmented
+ * in a single pass. Each trigram is labeled with the language of the window
+ * centered on it, and runs shorter than half a window are absorbed by the
+ * neighboring spans.
+ *
+ * @param s The text, encoded as UTF-8
+ * @param model The language model
+ * @param windowSize Window length, in trigrams
+ * @return LanguageSpans Contiguous spans covering the whole text
+ */
+LanguageSpans segmentLanguages(const string &s, const LanguageModel &model, size_t windowSize)
+{
+    LanguageSpans spans;
+    if (s.empty() || model.languageCodes.empty())
+        return spans;
+    if (windowSize < 1)
+        windowSize = 1;
+
+    // Decodes and case folds the text, keeping the byte offset of every
+    // code point
+    vector<char32_t> codePoints;
+    vector<size_t> offsets;
+    for (size_t position = 0; position < s.size();)
+    {
+        offsets.push_back(position);
+        codePoints.push_back(foldCase(getNextUTF8(s, position)));
+    }
+
+    // Trigram id sequence (trigrams do not cross line breaks). Trigrams
+    // outside the vocabulary take a window slot, but have no weights
+    vector<uint32_t> trigrams;
+    vector<size_t> trigramOffsets;
+
+    string trigram;
+    for (size_t i = 0; i + 2 < codePoints.size(); i++)
+    {
+        bool isTrigram = true;
+        trigram.clear();
+        for (size_t j = i; j < i + 3; j++)
+        {
+            if (codePoints[j] == '\n' || codePoints[j] == '\r')
+                isTrigram = false;
+            appendUTF8(trigram, codePoints[j]);
+        }
+        if (!isTrigram)
+            continue;
+
+        trigrams.push_back(model.vocabulary.find(trigram));
+        trigramOffsets.push_back(offsets[i]);
+    }
+
+    if (trigrams.empty())
+    {
+        spans.push_back(LanguageSpan{0, s.size(), ""});
+        return spans;
+    }
+
+    // Slides the window, labeling the trigram at its center
+    size_t trigramNum = trigrams.size();
+    if (windowSize > trigramNum)
+        windowSize = trigramNum;
+
+    vector<float> dotProducts(model.rowSize, 0.0f);
+    vector<int> labels(trigramNum, -1);
+
+    for (size_t i = 0; i < trigramNum; i++)
+    {
+        if (trigrams[i] != NO_TRIGRAM_ID)
+            accumulateRow(model.getRow(trigrams[i]), 1.0f, dotProducts.data(), model.rowSize);
+
+        if ((i >= windowSize) && (trigrams[i - windowSize] != NO_TRIGRAM_ID))
+            accumulateRow(model.getRow(trigrams[i - windowSize]), -1.0f, dotProducts.data(), model.rowSize);
+
+        if (i + 1 < windowSize)
+            continue;
+
+        float max = 0.0f;
+        int label = -1;
+        for (size_t j = 0; j < model.languageCodes.size(); j++)
+        {
+            if (dotProducts[j] > max)
+            {
+                max = dotProducts[j];
+                label = (int)j;
+            }
+        }
+
+        size_t windowStart = i + 1 - windowSize;
+        size_t center = windowStart + windowSize / 2;
+        if (windowStart == 0)
+        {
+            for (size_t j = 0; j < center; j++)
+                labels[j] = label;
+        }
+        labels[center] = label;
+        if (i + 1 == trigramNum)
+        {
+            for (size_t j = center + 1; j < trigramNum; j++)
+                labels[j] = label;
+        }
+    }
+
+    // Runs of equal labels. Mixed windows near a language change produce
+    // short runs of unrelated languages; they are given to the surrounding
+    // long runs, switching at the first short run that already agrees with
+    // the following language
+    struct Run
+    {
+        size_t begin;
+        size_t end;
+        int label;
+    };
+    vector<Run> runs;
+    for (size_t i = 0; i < trigramNum; i++)
+    {
+        if (runs.empty() || runs.back().label != labels[i])
+            runs.push_back(Run{i, i + 1, labels[i]});
+        else
+            runs.back().end = i + 1;
+    }
+
+    size_t minRunLength = windowSize / 2;
+    vector<size_t> longRuns;
+    for (size_t i = 0; i < runs.size(); i++)
+    {
+        if (runs[i].end - runs[i].begin >= minRunLength)
+            longRuns.push_back(i);
+    }
+    if (longRuns.empty())
+        longRuns.push_back(0);
+
+    for (size_t i = 0; i < longRuns.front(); i++)
+        runs[i].label = runs[longRuns.front()].label;
+    for (size_t i = longRuns.back() + 1; i < runs.size(); i++)
+        runs[i].label = runs[longRuns.back()].label;
+
+    for (size_t i = 0; i + 1 < longRuns.size(); i++)
+    {
+        int previousLabel = runs[longRuns[i]].label;
+        int nextLabel = runs[longRuns[i + 1]].label;
+
+        size_t switchRun = longRuns[i + 1];
+        for (size_t j = longRuns[i] + 1; j < longRuns[i + 1]; j++)
+        {
+            if (runs[j].label == nextLabel)
+            {
+                switchRun = j;
+                break;
+            }
+        }
+        if (switchRun == longRuns[i + 1])
+            switchRun = (longRuns[i] + 1 + longRuns[i + 1]) / 2;
+
+        for (size_t j = longRuns[i] + 1; j < longRuns[i + 1]; j++)
+            runs[j].label = j < switchRun ? previousLabel : nextLabel;
+    }
+
+    // Merges runs into spans
+    for (auto &run : runs)
+    {
+        string languageCode = run.label < 0 ? "" : model.languageCodes[run.label];
+        size_t begin = run.begin ? trigramOffsets[run.begin] : 0;
+        size_t end = run.end < trigramNum ? trigramOffsets[run.end] : s.size();
+
+        if (!spans.empty() && spans.back().languageCode == languageCode)
+            spans.back().end = end;
+        else
+            spans.push_back(LanguageSpan{begin, end, languageCode});
+    }
+
+    return spans;
+}
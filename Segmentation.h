@@ -0,0 +1,30 @@
+/**
+ * @brief Lequel? language segmentation of mixed-language text
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef SEGMENTATION_H
+#define SEGMENTATION_H
+
+#include <string>
+#include <vector>
+
+#include "LanguageModel.h"
+
+// LanguageSpan: a run of text in one language, as byte offsets [begin, end)
+struct LanguageSpan
+{
+    size_t begin;
+    size_t end;
+    std::string languageCode;
+};
+
+typedef std::vector<LanguageSpan> LanguageSpans;
+
+// Functions
+LanguageSpans segmentLanguages(const std::string &s, const LanguageModel &model,
+                               size_t windowSize = 48);
+
+#endif
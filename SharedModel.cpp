@@ -0,0 +1,384 @@
+/**
+ * @brief Lequel? language model in shared memory
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ *
+ * @cite https://man7.org/linux/man-pages/man7/shm_overview.7.html
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "NgramProfile.h"
+#include "SharedModel.h"
+#include "SimdKernels.h"
+#include "Tracing.h"
+
+using namespace std;
+
+const uint32_t SHARED_MODEL_MAGIC = 0x4d51454c; // "LEQM"
+const uint32_t SHARED_MODEL_VERSION = 1;
+
+/**
+ * @brief Rounds an offset up to SHARED_SECTION_ALIGNMENT.
+ */
+static uint64_t alignSection(uint64_t offset)
+{
+    return (offset + SHARED_SECTION_ALIGNMENT - 1) & ~(uint64_t)(SHARED_SECTION_ALIGNMENT - 1);
+}
+
+/**
+ * @brief Returns a valid POSIX shared memory object name ("/name").
+ */
+static string getSharedObjectName(const string &name)
+{
+    return (!name.empty() && (name[0] == '/')) ? name : "/" + name;
+}
+
+/**
+ * @brief Lays out the sections of a shared model image.
+ *
+ * @param header Header with languageNum, trigramNum and rowSize set;
+ * receives tableSize, the section offsets and byteSize
+ */
+static void layOutSharedModel(SharedModelHeader &header)
+{
+    // At most half the table slots are used, so probe sequences stay short
+    header.tableSize = 1;
+    while (header.tableSize < 2 * (uint64_t)header.trigramNum)
+        header.tableSize <<= 1;
+
+    uint64_t offset = alignSection(sizeof(SharedModelHeader));
+    header.languagesOffset = offset;
+    offset = alignSection(offset + (uint64_t)header.languageNum * sizeof(SharedLanguage));
+    header.tableKeysOffset = offset;
+    offset = alignSection(offset + (uint64_t)header.tableSize * sizeof(uint64_t));
+    header.tableIdsOffset = offset;
+    offset = alignSection(offset + (uint64_t)header.tableSize * sizeof(uint32_t));
+    header.weightsOffset = offset;
+    offset = alignSection(offset + (uint64_t)header.trigramNum * header.rowSize * sizeof(float));
+    header.maxWeightsOffset = offset;
+    offset = alignSection(offset + (uint64_t)header.languageNum * sizeof(float));
+    header.trigramMaxWeightsOffset = offset;
+    offset = alignSection(offset + (uint64_t)header.trigramNum * sizeof(float));
+    header.byteSize = offset;
+}
+
+/**
+ * @brief Points a shared model view at the sections of an image.
+ */
+static void setSharedModelSections(const void *data, SharedModel &sharedModel)
+{
+    const SharedModelHeader &header = *(const SharedModelHeader *)data;
+    const char *base = (const char *)data;
+
+    sharedModel.data = data;
+    sharedModel.byteSize = header.byteSize;
+    sharedModel.languageNum = header.languageNum;
+    sharedModel.trigramNum = header.trigramNum;
+    sharedModel.rowSize = header.rowSize;
+    sharedModel.tableSize = header.tableSize;
+    sharedModel.languages = (const SharedLanguage *)(base + header.languagesOffset);
+    sharedModel.tableKeys = (const uint64_t *)(base + header.tableKeysOffset);
+    sharedModel.tableIds = (const uint32_t *)(base + header.tableIdsOffset);
+    sharedModel.weights = (const float *)(base + header.weightsOffset);
+    sharedModel.maxWeights = (const float *)(base + header.maxWeightsOffset);
+    sharedModel.trigramMaxWeights = (const float *)(base + header.trigramMaxWeightsOffset);
+}
+
+/**
+ * @brief Copies a string into a fixed-size, '\0'-terminated field
+ * (truncating it if needed).
+ */
+static void copyField(const string &s, char *field, size_t fieldSize)
+{
+    size_t size = min(s.size(), fieldSize - 1);
+    memcpy(field, s.data(), size);
+    field[size] = '\0';
+}
+
+/**
+ * @brief Writes a model image into a zero-filled buffer.
+ *
+ * @param model The language model
+ * @param languageCodeNames Language names, by code
+ * @param header Header laid out by layOutSharedModel()
+ * @param data Destination buffer of header.byteSize bytes, zero-filled
+ */
+static void writeSharedModel(const LanguageModel &model, const map<string, string> &languageCodeNames,
+                             const SharedModelHeader &header, void *data)
+{
+    char *base = (char *)data;
+
+    SharedModelHeader *imageHeader = (SharedModelHeader *)data;
+    *imageHeader = header;
+    imageHeader->magic = 0;
+
+    SharedLanguage *languages = (SharedLanguage *)(base + header.languagesOffset);
+    for (uint32_t i = 0; i < header.languageNum; i++)
+    {
+        const string &languageCode = model.languageCodes[i];
+        auto name = languageCodeNames.find(languageCode);
+
+        copyField(languageCode, languages[i].code, SHARED_LANGUAGE_CODE_SIZE);
+        copyField(name != languageCodeNames.end() ? name->second : "", languages[i].name,
+                  SHARED_LANGUAGE_NAME_SIZE);
+    }
+
+    uint64_t *tableKeys = (uint64_t *)(base + header.tableKeysOffset);
+    uint32_t *tableIds = (uint32_t *)(base + header.tableIdsOffset);
+    for (uint32_t id = 0; id < header.trigramNum; id++)
+    {
+        uint64_t key;
+        if (!getNgramKey<3>(model.vocabulary.getTrigram(id), key))
+            continue;
+
+        size_t slot = model.trigramHashes[id] & (header.tableSize - 1);
+        while (tableKeys[slot])
+            slot = (slot + 1) & (header.tableSize - 1);
+        tableKeys[slot] = key;
+        tableIds[slot] = id;
+    }
+
+    memcpy(base + header.weightsOffset, model.weights.data(), model.weights.size() * sizeof(float));
+    memcpy(base + header.maxWeightsOffset, model.maxWeights.data(), model.maxWeights.size() * sizeof(float));
+    memcpy(base + header.trigramMaxWeightsOffset, model.trigramMaxWeights.data(),
+           model.trigramMaxWeights.size() * sizeof(float));
+
+    // The image is complete before attaching processes can see the magic
+    atomic_thread_fence(memory_order_release);
+    imageHeader->magic = SHARED_MODEL_MAGIC;
+}
+
+/**
+ * @brief Finds the id of a trigram.
+ *
+ * @param trigramKey The packed trigram (NgramKey<3>)
+ * @return uint32_t The trigram id, or NO_TRIGRAM_ID if not in the model
+ */
+uint32_t SharedModel::findTrigram(uint64_t trigramKey) const
+{
+    if (!trigramKey)
+        return NO_TRIGRAM_ID;
+
+    size_t slot = getTrigramKeyHash(trigramKey) & (tableSize - 1);
+    while (tableKeys[slot])
+    {
+        if (tableKeys[slot] == trigramKey)
+            return tableIds[slot];
+        slot = (slot + 1) & (tableSize - 1);
+    }
+
+    return NO_TRIGRAM_ID;
+}
+
+/**
+ * @brief Builds a model image in a named shared memory object.
+ *
+ * Any previous object with the same name is removed first; processes that
+ * attached it keep their mapping until they detach.
+ *
+ * @param name The shared memory object name
+ * @param model The language model
+ * @param languageCodeNames Language names, by code
+ * @return true Succeeded
+ * @return false Failed
+ */
+bool publishSharedModel(const string &name, const LanguageModel &model,
+                        const map<string, string> &languageCodeNames)
+{
+#ifdef _WIN32
+    fprintf(stderr, "Shared memory models are not supported on this platform.\n");
+    return false;
+#else
+    string objectName = getSharedObjectName(name);
+
+    SharedModelHeader header = {};
+    header.magic = SHARED_MODEL_MAGIC;
+    header.version = SHARED_MODEL_VERSION;
+    header.languageNum = (uint32_t)model.languageCodes.size();
+    header.trigramNum = (uint32_t)model.vocabulary.size();
+    header.rowSize = (uint32_t)model.rowSize;
+    layOutSharedModel(header);
+
+    shm_unlink(objectName.c_str());
+    int fd = shm_open(objectName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        perror(("Error while creating shared memory " + objectName).c_str());
+        return false;
+    }
+
+    // ftruncate() zero-fills, so empty table slots need no writes
+    void *data = MAP_FAILED;
+    if (ftruncate(fd, (off_t)header.byteSize) == 0)
+        data = mmap(nullptr, header.byteSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        perror(("Error while writing shared memory " + objectName).c_str());
+        shm_unlink(objectName.c_str());
+        return false;
+    }
+
+    writeSharedModel(model, languageCodeNames, header, data);
+    munmap(data, header.byteSize);
+
+    return true;
+#endif
+}
+
+/**
+ * @brief Attaches a model image published by publishSharedModel().
+ *
+ * The image is mapped read-only and shared with every other attached
+ * process, so attaching neither copies nor parses the model.
+ *
+ * @param name The shared memory object name
+ * @param sharedModel Destination view
+ * @return true Succeeded
+ * @return false Not found, incomplete or of another version
+ */
+bool attachSharedModel(const string &name, SharedModel &sharedModel)
+{
+    sharedModel = SharedModel();
+
+#ifdef _WIN32
+    fprintf(stderr, "Shared memory models are not supported on this platform.\n");
+    return false;
+#else
+    string objectName = getSharedObjectName(name);
+
+    int fd = shm_open(objectName.c_str(), O_RDONLY, 0);
+    struct stat objectStat;
+    if ((fd < 0) || (fstat(fd, &objectStat) < 0))
+    {
+        perror(("Error while opening shared memory " + objectName).c_str());
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    size_t objectSize = (size_t)objectStat.st_size;
+    void *data = MAP_FAILED;
+    if (objectSize >= sizeof(SharedModelHeader))
+        data = mmap(nullptr, objectSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "Error while mapping shared memory %s.\n", objectName.c_str());
+        return false;
+    }
+
+    const SharedModelHeader &header = *(const SharedModelHeader *)data;
+    bool isValid = (header.magic == SHARED_MODEL_MAGIC) &&
+                   (header.version == SHARED_MODEL_VERSION) &&
+                   (header.byteSize == objectSize);
+    atomic_thread_fence(memory_order_acquire);
+    if (!isValid)
+    {
+        fprintf(stderr, "Shared memory %s holds no complete model.\n", objectName.c_str());
+        munmap(data, objectSize);
+        return false;
+    }
+
+    setSharedModelSections(data, sharedModel);
+
+    return true;
+#endif
+}
+
+/**
+ * @brief Unmaps an attached model image.
+ */
+void detachSharedModel(SharedModel &sharedModel)
+{
+#ifndef _WIN32
+    if (sharedModel.data)
+        munmap((void *)sharedModel.data, sharedModel.byteSize);
+#endif
+
+    sharedModel = SharedModel();
+}
+
+/**
+ * @brief Removes a named model image. Attached processes keep their mapping.
+ *
+ * @param name The shared memory object name
+ * @return true Succeeded
+ * @return false No such object
+ */
+bool removeSharedModel(const string &name)
+{
+#ifdef _WIN32
+    return false;
+#else
+    return shm_unlink(getSharedObjectName(name).c_str()) == 0;
+#endif
+}
+
+/**
+ * @brief Identifies the language of a text with a shared model.
+ *
+ * Scores all languages exhaustively, as identifyLanguage() does for models
+ * below PRUNING_MIN_LANGUAGES languages.
+ *
+ * @param text A Text (vector of lines)
+ * @param sharedModel The shared model
+ * @param skipNoise Skip markup, URLs and numbers (see findNoiseSpans())
+ * @return string The language code of the most likely language
+ */
+string identifyLanguage(const Text &text, const SharedModel &sharedModel, bool skipNoise)
+{
+    TraceSpan span("score (shared)");
+
+    NgramProfile<3> ngramProfile;
+    buildNgramProfile<3>(text, ngramProfile, nullptr, skipNoise);
+
+    float norm = 0.0f;
+    for (auto &entry : ngramProfile)
+        norm += entry.second * entry.second;
+    norm = sqrt(norm);
+    if ((norm == 0.0f) || !sharedModel.languageNum)
+        return "";
+
+    // Rows are visited in id order, as in memory
+    TrigramIdProfile textProfile;
+    for (auto &entry : ngramProfile)
+    {
+        uint32_t id = sharedModel.findTrigram(entry.first);
+        if (id != NO_TRIGRAM_ID)
+            textProfile.push_back(make_pair(id, entry.second / norm));
+    }
+    sort(textProfile.begin(), textProfile.end());
+
+    vector<float> scores(sharedModel.rowSize, 0.0f);
+    for (auto &entry : textProfile)
+        accumulateRow(sharedModel.getRow(entry.first), entry.second, scores.data(), sharedModel.rowSize);
+
+    float max = 0.0f;
+    const char *languageCode = "";
+    for (uint32_t i = 0; i < sharedModel.languageNum; i++)
+    {
+        if (scores[i] > max)
+        {
+            max = scores[i];
+            languageCode = sharedModel.languages[i].code;
+        }
+    }
+
+    return languageCode;
+}
@@ -0,0 +1,92 @@
+/**
+ * @brief Lequel? language model in shared memory
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef SHAREDMODEL_H
+#define SHAREDMODEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "LanguageModel.h"
+#include "Text.h"
+
+// Sizes of the language code and name fields (with their terminating '\0')
+const size_t SHARED_LANGUAGE_CODE_SIZE = 16;
+const size_t SHARED_LANGUAGE_NAME_SIZE = 112;
+
+// Alignment of the shared model sections, in bytes
+const size_t SHARED_SECTION_ALIGNMENT = 64;
+
+// SharedModelHeader: start of a shared model image. Sections are located by
+// byte offsets from the start of the image, so it contains no pointers and
+// can be mapped at any address. magic is written last, once the image is
+// complete.
+struct SharedModelHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t byteSize;
+
+    uint32_t languageNum;
+    uint32_t trigramNum;
+    uint32_t rowSize;
+    uint32_t tableSize;
+
+    uint64_t languagesOffset;
+    uint64_t tableKeysOffset;
+    uint64_t tableIdsOffset;
+    uint64_t weightsOffset;
+    uint64_t maxWeightsOffset;
+    uint64_t trigramMaxWeightsOffset;
+};
+
+// SharedLanguage: code and name of a language, '\0'-terminated
+struct SharedLanguage
+{
+    char code[SHARED_LANGUAGE_CODE_SIZE];
+    char name[SHARED_LANGUAGE_NAME_SIZE];
+};
+
+// SharedModel: a read-only view of a shared model image. Trigrams are found
+// by packed key (NgramKey<3>) in an open-addressing table of tableSize
+// slots; an empty slot has key 0.
+struct SharedModel
+{
+    const void *data;
+    size_t byteSize;
+
+    uint32_t languageNum;
+    uint32_t trigramNum;
+    uint32_t rowSize;
+    uint32_t tableSize;
+
+    const SharedLanguage *languages;
+    const uint64_t *tableKeys;
+    const uint32_t *tableIds;
+    const float *weights;
+    const float *maxWeights;
+    const float *trigramMaxWeights;
+
+    const float *getRow(uint32_t trigramId) const
+    {
+        return &weights[(size_t)trigramId * rowSize];
+    }
+
+    uint32_t findTrigram(uint64_t trigramKey) const;
+};
+
+// Functions
+bool publishSharedModel(const std::string &name, const LanguageModel &model,
+                        const std::map<std::string, std::string> &languageCodeNames);
+bool attachSharedModel(const std::string &name, SharedModel &sharedModel);
+void detachSharedModel(SharedModel &sharedModel);
+bool removeSharedModel(const std::string &name);
+std::string identifyLanguage(const Text &text, const SharedModel &sharedModel, bool skipNoise = false);
+
+#endif
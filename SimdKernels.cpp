@@ -0,0 +1,220 @@
+/**
+ * @brief Lequel? vectorized scoring kernels with runtime CPU dispatch
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include "SimdKernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LEQUEL_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+typedef void (*AccumulateRowFunction)(const float *row, float weight, float *scores, size_t size);
+typedef size_t (*FindNoiseCandidateFunction)(const char *data, size_t size);
+
+/**
+ * @brief scores += weight * row, portable version.
+ */
+static void accumulateRowScalar(const float *row, float weight, float *scores, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        scores[i] += weight * row[i];
+}
+
+/**
+ * @brief Whether a byte may start text noise: markup ('<', '&'), a URL
+ * (':', '.'), an e-mail address ('@') or a digit.
+ */
+static inline bool isNoiseCandidate(unsigned char c)
+{
+    return (c == '<') || (c == '&') || (c == ':') || (c == '.') || (c == '@') || ((unsigned char)(c - '0') < 10);
+}
+
+/**
+ * @brief Finds the first noise candidate byte, portable version.
+ */
+static size_t findNoiseCandidateScalar(const char *data, size_t size)
+{
+    size_t i = 0;
+    while ((i < size) && !isNoiseCandidate((unsigned char)data[i]))
+        i++;
+
+    return i;
+}
+
+#ifdef LEQUEL_X86_DISPATCH
+/**
+ * @brief Finds the first noise candidate byte, SSE2 version (16 bytes per
+ * step).
+ */
+__attribute__((target("sse2"))) static size_t findNoiseCandidateSSE2(const char *data, size_t size)
+{
+    const __m128i lessThan = _mm_set1_epi8('<');
+    const __m128i ampersand = _mm_set1_epi8('&');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i period = _mm_set1_epi8('.');
+    const __m128i at = _mm_set1_epi8('@');
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+
+        // Digits: v - '0' <= 9, unsigned
+        __m128i digit = _mm_sub_epi8(v, zero);
+        __m128i matches = _mm_cmpeq_epi8(_mm_min_epu8(digit, nine), digit);
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(v, lessThan));
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(v, ampersand));
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(v, colon));
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(v, period));
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(v, at));
+
+        int mask = _mm_movemask_epi8(matches);
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+
+    return i + findNoiseCandidateScalar(data + i, size - i);
+}
+
+/**
+ * @brief Finds the first noise candidate byte, AVX2 version (32 bytes per
+ * step).
+ */
+__attribute__((target("avx2"))) static size_t findNoiseCandidateAVX2(const char *data, size_t size)
+{
+    const __m256i lessThan = _mm256_set1_epi8('<');
+    const __m256i ampersand = _mm256_set1_epi8('&');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i period = _mm256_set1_epi8('.');
+    const __m256i at = _mm256_set1_epi8('@');
+    const __m256i zero = _mm256_set1_epi8('0');
+    const __m256i nine = _mm256_set1_epi8(9);
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+
+        __m256i digit = _mm256_sub_epi8(v, zero);
+        __m256i matches = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, nine), digit);
+        matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(v, lessThan));
+        matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(v, ampersand));
+        matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(v, colon));
+        matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(v, period));
+        matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(v, at));
+
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(matches);
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+
+    return i + findNoiseCandidateScalar(data + i, size - i);
+}
+
+/**
+ * @brief scores += weight * row, AVX2 + FMA version.
+ */
+__attribute__((target("avx2,fma"))) static void accumulateRowAVX2(const float *row, float weight,
+                                                                  float *scores, size_t size)
+{
+    __m256 w = _mm256_set1_ps(weight);
+    for (size_t i = 0; i < size; i += 8)
+    {
+        __m256 s = _mm256_loadu_ps(scores + i);
+        s = _mm256_fmadd_ps(w, _mm256_loadu_ps(row + i), s);
+        _mm256_storeu_ps(scores + i, s);
+    }
+}
+
+/**
+ * @brief scores += weight * row, AVX-512 version.
+ */
+__attribute__((target("avx512f"))) static void accumulateRowAVX512(const float *row, float weight,
+                                                                  float *scores, size_t size)
+{
+    __m512 w = _mm512_set1_ps(weight);
+    for (size_t i = 0; i < size; i += 16)
+    {
+        __m512 s = _mm512_loadu_ps(scores + i);
+        s = _mm512_fmadd_ps(w, _mm512_loadu_ps(row + i), s);
+        _mm512_storeu_ps(scores + i, s);
+    }
+}
+#endif
+
+// Kernel selected for this CPU, and its name
+static const char *simdLevelName = "scalar";
+
+static AccumulateRowFunction selectAccumulateRow()
+{
+#ifdef LEQUEL_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        simdLevelName = "avx512";
+        return accumulateRowAVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        simdLevelName = "avx2";
+        return accumulateRowAVX2;
+    }
+#endif
+    return accumulateRowScalar;
+}
+
+static const AccumulateRowFunction accumulateRowFunction = selectAccumulateRow();
+
+static FindNoiseCandidateFunction selectFindNoiseCandidate()
+{
+#ifdef LEQUEL_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return findNoiseCandidateAVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return findNoiseCandidateSSE2;
+#endif
+    return findNoiseCandidateScalar;
+}
+
+static const FindNoiseCandidateFunction findNoiseCandidateFunction = selectFindNoiseCandidate();
+
+/**
+ * @brief Adds a weighted row to a score vector: scores += weight * row.
+ *
+ * @param row The row
+ * @param weight The weight
+ * @param scores The score vector
+ * @param size Length of row and scores, a multiple of SIMD_ROW_ALIGNMENT
+ */
+void accumulateRow(const float *row, float weight, float *scores, size_t size)
+{
+    accumulateRowFunction(row, weight, scores, size);
+}
+
+/**
+ * @brief Finds the first byte that may start text noise: '<', '&', ':',
+ * '.', '@' or a digit.
+ *
+ * @param data The bytes
+ * @param size Number of bytes
+ * @return size_t Index of the first candidate, or size if there is none
+ */
+size_t findNoiseCandidate(const char *data, size_t size)
+{
+    return findNoiseCandidateFunction(data, size);
+}
+
+/**
+ * @brief Name of the kernel selected for this CPU ("avx512", "avx2" or "scalar").
+ */
+const char *getSimdLevelName()
+{
+    return simdLevelName;
+}
@@ -0,0 +1,21 @@
+/**
+ * @brief Lequel? vectorized scoring kernels with runtime CPU dispatch
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+
+#include <cstddef>
+
+// Row length multiple required by the kernels (one AVX-512 register)
+const size_t SIMD_ROW_ALIGNMENT = 16;
+
+// Functions
+void accumulateRow(const float *row, float weight, float *scores, size_t size);
+size_t findNoiseCandidate(const char *data, size_t size);
+const char *getSimdLevelName();
+
+#endif
@@ -8,6 +8,7 @@
 #include <fstream>
 
 #include "Text.h"
+#include "Tracing.h"
 
 using namespace std;
 
@@ -49,6 +50,8 @@ bool getTextFromString(const string &s, Text &text)
  */
 bool getTextFromFile(const string path, Text &text)
 {
+    TraceSpan span("getTextFromFile");
+
     ifstream file(path, ios::binary);
 
     if (!file.is_open())
@@ -75,3 +78,84 @@ bool getTextFromFile(const string path, Text &text)
 
     return getTextFromString(fileData, text);
 }
+
+/**
+ * @brief Appends a Unicode code point to a string, encoded as UTF-8.
+ *
+ * @param s Destination string
+ * @param c The code point
+ */
+void appendUTF8(string &s, char32_t c)
+{
+    if (c < 0x80)
+        s += (char)c;
+    else if (c < 0x800)
+    {
+        s += (char)(0xc0 | (c >> 6));
+        s += (char)(0x80 | (c & 0x3f));
+    }
+    else if (c < 0x10000)
+    {
+        s += (char)(0xe0 | (c >> 12));
+        s += (char)(0x80 | ((c >> 6) & 0x3f));
+        s += (char)(0x80 | (c & 0x3f));
+    }
+    else
+    {
+        s += (char)(0xf0 | (c >> 18));
+        s += (char)(0x80 | ((c >> 12) & 0x3f));
+        s += (char)(0x80 | ((c >> 6) & 0x3f));
+        s += (char)(0x80 | (c & 0x3f));
+    }
+}
+
+/**
+ * @brief Decodes the UTF-8 code point at a position.
+ *
+ * Invalid sequences decode as U+FFFD, one byte at a time.
+ *
+ * @param s The string
+ * @param position Byte position, advanced past the code point
+ * @return char32_t The code point
+ */
+char32_t getNextUTF8(const string &s, size_t &position)
+{
+    unsigned char c = s[position++];
+    if (c < 0x80)
+        return c;
+
+    int length;
+    char32_t codePoint;
+    if ((c & 0xe0) == 0xc0)
+    {
+        length = 1;
+        codePoint = c & 0x1f;
+    }
+    else if ((c & 0xf0) == 0xe0)
+    {
+        length = 2;
+        codePoint = c & 0x0f;
+    }
+    else if ((c & 0xf8) == 0xf0)
+    {
+        length = 3;
+        codePoint = c & 0x07;
+    }
+    else
+        return 0xfffd;
+
+    if (position + length > s.size())
+        return 0xfffd;
+
+    for (int i = 0; i < length; i++)
+    {
+        unsigned char next = s[position + i];
+        if ((next & 0xc0) != 0x80)
+            return 0xfffd;
+
+        codePoint = (codePoint << 6) | (next & 0x3f);
+    }
+    position += length;
+
+    return codePoint;
+}
@@ -17,5 +17,7 @@ typedef std::list<std::string> Text; //lista doblemente enlazada
 // Functions
 bool getTextFromString(const std::string &s, Text &text);
 bool getTextFromFile(const std::string path, Text &text);
+void appendUTF8(std::string &s, char32_t c);
+char32_t getNextUTF8(const std::string &s, size_t &position);
 
 #endif
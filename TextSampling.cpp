@@ -0,0 +1,314 @@
+/**
+ * @brief Lequel? sampling of huge text inputs
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ *
+ * @cite https://en.wikipedia.org/wiki/Reservoir_sampling#Optimal:_Algorithm_L
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#ifdef _WIN32
+#define LEQUEL_MMAP 0
+#else
+#define LEQUEL_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "TextSampling.h"
+#include "Tracing.h"
+
+using namespace std;
+
+/**
+ * @brief Appends the '\n'-separated lines of a buffer to a text.
+ */
+static void appendLines(const char *data, size_t size, Text &text)
+{
+    const char *end = data + size;
+    while (data < end)
+    {
+        const char *lineEnd = data;
+        while ((lineEnd < end) && (*lineEnd != '\n'))
+            lineEnd++;
+
+        size_t lineSize = lineEnd - data;
+        if (lineSize && (data[lineSize - 1] == '\r'))
+            lineSize--;
+        text.push_back(string(data, lineSize));
+
+        data = lineEnd + 1;
+    }
+}
+
+/**
+ * @brief Trims a block to whole lines, so no line or code point is cut.
+ *
+ * A block that starts mid-file drops its first partial line, and a block
+ * that ends mid-file drops its last one. A block without line breaks is
+ * trimmed to UTF-8 code point boundaries instead.
+ *
+ * @param block The block bytes
+ * @param isFirst The block starts at the beginning of the file
+ * @param isLast The block ends at the end of the file
+ * @param begin Destination first byte to keep
+ * @param end Destination past-the-end byte to keep
+ */
+static void alignBlock(const string &block, bool isFirst, bool isLast, size_t &begin, size_t &end)
+{
+    begin = 0;
+    end = block.size();
+
+    if (!isFirst)
+    {
+        size_t position = block.find('\n');
+        if (position != string::npos)
+            begin = position + 1;
+        else
+        {
+            while ((begin < end) && (((unsigned char)block[begin] & 0xc0) == 0x80))
+                begin++;
+        }
+    }
+
+    if (!isLast)
+    {
+        size_t position = block.rfind('\n');
+        if ((position != string::npos) && (position >= begin))
+            end = position;
+        else
+        {
+            while ((end > begin) && (((unsigned char)block[end - 1] & 0xc0) == 0x80))
+                end--;
+            if ((end > begin) && ((unsigned char)block[end - 1] >= 0xc0))
+                end--;
+        }
+    }
+}
+
+/**
+ * @brief Samples a file by reading evenly spaced blocks.
+ *
+ * Files within the byte budget are read whole. Larger files are read as
+ * byteBudget / SAMPLE_BLOCK_SIZE blocks spread over the whole file, so the
+ * cost depends on the budget and not on the file size. The file is mapped
+ * in memory, so only the sampled pages are read from disk.
+ *
+ * @param path Path of file to read
+ * @param byteBudget Maximum number of bytes to read
+ * @param sample Destination sample
+ * @return true Succeeded
+ * @return false The file could not be read
+ */
+bool getSampledTextFromFile(const string &path, size_t byteBudget, TextSample &sample)
+{
+    TraceSpan span("getSampledTextFromFile");
+
+    sample.text.clear();
+    sample.sampledBytes = 0;
+    sample.totalBytes = 0;
+
+#if LEQUEL_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat fileStat;
+    if ((fd < 0) || (fstat(fd, &fileStat) < 0))
+    {
+        perror(("Error while opening file " + path).c_str());
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    size_t fileSize = (size_t)fileStat.st_size;
+    const char *fileData = nullptr;
+    if (fileSize)
+    {
+        void *mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            perror(("Error while reading file: " + path).c_str());
+            close(fd);
+            return false;
+        }
+        fileData = (const char *)mapping;
+        if (fileSize > byteBudget)
+            madvise(mapping, fileSize, MADV_RANDOM);
+    }
+    close(fd);
+#else
+    ifstream file(path, ios::binary);
+    if (!file.is_open())
+    {
+        perror(("Error while opening file " + path).c_str());
+        return false;
+    }
+
+    file.seekg(0, ios::end);
+    size_t fileSize = (size_t)file.tellg();
+#endif
+
+    sample.totalBytes = fileSize;
+
+    size_t blockSize = fileSize;
+    size_t blockNum = 1;
+    if (fileSize > byteBudget)
+    {
+        blockNum = max(byteBudget / SAMPLE_BLOCK_SIZE, SAMPLE_MIN_BLOCK_NUM);
+        blockSize = byteBudget / blockNum;
+        if (blockSize < SAMPLE_MIN_BLOCK_SIZE)
+        {
+            blockSize = min(byteBudget, SAMPLE_MIN_BLOCK_SIZE);
+            blockNum = byteBudget / blockSize;
+        }
+    }
+
+    // A single block is taken from the middle of the file
+    size_t stride = blockNum > 1 ? (fileSize - blockSize) / (blockNum - 1) : 0;
+    size_t firstOffset = blockNum > 1 ? 0 : (fileSize - blockSize) / 2;
+
+    bool succeeded = true;
+    string block;
+    for (size_t i = 0; (i < blockNum) && blockSize; i++)
+    {
+        size_t offset = firstOffset + i * stride;
+
+#if LEQUEL_MMAP
+        block.assign(fileData + offset, blockSize);
+#else
+        block.resize(blockSize);
+        file.seekg(offset);
+        file.read(&block[0], blockSize);
+        if (file.fail())
+        {
+            perror(("Error while reading file: " + path).c_str());
+            succeeded = false;
+            break;
+        }
+#endif
+
+        size_t begin, end;
+        alignBlock(block, offset == 0, offset + blockSize == fileSize, begin, end);
+
+        appendLines(block.data() + begin, end - begin, sample.text);
+        sample.sampledBytes += end - begin;
+    }
+
+#if LEQUEL_MMAP
+    if (fileData)
+        munmap((void *)fileData, fileSize);
+#endif
+
+    return succeeded;
+}
+
+/**
+ * @brief Samples the lines of a stream with a reservoir.
+ *
+ * Lines are kept until they fill the byte budget. From then on, the n-th
+ * line replaces a random kept line with probability k / n (k being the
+ * number of kept lines), so every line has the same chance of ending up in
+ * the sample. The gaps between replacements are drawn directly (Algorithm
+ * L), so skipped lines are never copied. Lines longer than
+ * SAMPLE_BLOCK_SIZE are cut.
+ *
+ * @param stream The input stream
+ * @param byteBudget Approximate maximum number of bytes to keep
+ * @param sample Destination sample
+ * @param seed Random seed, for reproducible samples
+ * @return true Succeeded
+ * @return false The stream failed
+ */
+bool getSampledTextFromStream(istream &stream, size_t byteBudget, TextSample &sample, uint32_t seed)
+{
+    TraceSpan span("getSampledTextFromStream");
+
+    sample.text.clear();
+    sample.sampledBytes = 0;
+    sample.totalBytes = 0;
+
+    mt19937 random(seed);
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+    vector<string> reservoir;
+    bool isFull = false;
+    double w = 0.0;
+    uint64_t skipNum = 0;
+
+    // Lines to skip before the next replacement
+    auto getSkipNum = [&]()
+    { return (uint64_t)floor(log(uniform(random)) / log(1.0 - w)); };
+
+    string line;
+    while (true)
+    {
+        // Skipped lines are not copied
+        if (skipNum)
+        {
+            stream.ignore(numeric_limits<streamsize>::max(), '\n');
+            if (!stream.gcount())
+                break;
+            sample.totalBytes += stream.gcount();
+            skipNum--;
+            continue;
+        }
+
+        if (!getline(stream, line))
+            break;
+        sample.totalBytes += line.size() + 1;
+
+        if (line.size() > SAMPLE_BLOCK_SIZE)
+        {
+            size_t end = SAMPLE_BLOCK_SIZE;
+            while ((end > 0) && (((unsigned char)line[end] & 0xc0) == 0x80))
+                end--;
+            line.resize(end);
+        }
+        if (!line.empty() && (line.back() == '\r'))
+            line.pop_back();
+
+        if (!isFull && (reservoir.empty() || (sample.sampledBytes + line.size() + 1 <= byteBudget)))
+        {
+            sample.sampledBytes += line.size() + 1;
+            reservoir.push_back(line);
+            continue;
+        }
+
+        // The line that overflows the budget is the first candidate
+        if (!isFull)
+        {
+            isFull = true;
+            w = exp(log(uniform(random)) / reservoir.size());
+            skipNum = getSkipNum();
+            if (skipNum)
+            {
+                skipNum--;
+                continue;
+            }
+        }
+
+        size_t j = uniform_int_distribution<size_t>(0, reservoir.size() - 1)(random);
+        sample.sampledBytes += line.size();
+        sample.sampledBytes -= reservoir[j].size();
+        reservoir[j].swap(line);
+
+        w *= exp(log(uniform(random)) / reservoir.size());
+        skipNum = getSkipNum();
+    }
+
+    if (stream.bad())
+        return false;
+
+    for (auto &kept : reservoir)
+        sample.text.push_back(kept);
+
+    return true;
+}
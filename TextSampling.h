@@ -0,0 +1,43 @@
+/**
+ * @brief Lequel? sampling of huge text inputs
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef TEXTSAMPLING_H
+#define TEXTSAMPLING_H
+
+#include <cstdint>
+#include <istream>
+#include <string>
+
+#include "Text.h"
+
+// Bytes read per sampled file block
+const size_t SAMPLE_BLOCK_SIZE = 64 * 1024;
+
+// Small budgets are split into at least this many blocks, down to
+// SAMPLE_MIN_BLOCK_SIZE bytes each, so they still span the file
+const size_t SAMPLE_MIN_BLOCK_NUM = 8;
+const size_t SAMPLE_MIN_BLOCK_SIZE = 4 * 1024;
+
+// TextSample: the sampled lines of an input, and how much of it they cover
+struct TextSample
+{
+    Text text;
+    uint64_t sampledBytes;
+    uint64_t totalBytes;
+
+    float getSampledFraction() const
+    {
+        return totalBytes ? (float)sampledBytes / totalBytes : 1.0f;
+    }
+};
+
+// Functions
+bool getSampledTextFromFile(const std::string &path, size_t byteBudget, TextSample &sample);
+bool getSampledTextFromStream(std::istream &stream, size_t byteBudget, TextSample &sample,
+                              uint32_t seed = 1);
+
+#endif
@@ -0,0 +1,106 @@
+/**
+ * @brief Lequel? fixed-size thread pool
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+/**
+ * @brief Starts the worker threads.
+ *
+ * @param threadNum Number of threads (0: one per hardware thread)
+ */
+ThreadPool::ThreadPool(size_t threadNum) : activeTaskNum(0),
+                                           shouldStop(false)
+{
+    if (!threadNum)
+        threadNum = thread::hardware_concurrency();
+    if (!threadNum)
+        threadNum = 1;
+
+    for (size_t i = 0; i < threadNum; i++)
+        threads.push_back(thread(&ThreadPool::run, this));
+}
+
+/**
+ * @brief Discards queued tasks, waits for running ones and joins the threads.
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        shouldStop = true;
+        tasks.clear();
+    }
+    taskCondition.notify_all();
+
+    for (auto &thread : threads)
+        thread.join();
+}
+
+/**
+ * @brief Queues a task.
+ *
+ * @param task The task
+ */
+void ThreadPool::submit(const function<void()> &task)
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(task);
+    }
+    taskCondition.notify_one();
+}
+
+/**
+ * @brief Blocks until every queued task has finished.
+ */
+void ThreadPool::wait()
+{
+    unique_lock<std::mutex> lock(mutex);
+    idleCondition.wait(lock, [this]
+                       { return tasks.empty() && !activeTaskNum; });
+}
+
+/**
+ * @brief Number of worker threads.
+ */
+size_t ThreadPool::size() const
+{
+    return threads.size();
+}
+
+/**
+ * @brief Worker thread loop.
+ */
+void ThreadPool::run()
+{
+    while (true)
+    {
+        function<void()> task;
+        {
+            unique_lock<std::mutex> lock(mutex);
+            taskCondition.wait(lock, [this]
+                               { return shouldStop || !tasks.empty(); });
+            if (shouldStop)
+                return;
+
+            task = tasks.front();
+            tasks.pop_front();
+            activeTaskNum++;
+        }
+
+        task();
+
+        {
+            lock_guard<std::mutex> lock(mutex);
+            activeTaskNum--;
+            if (tasks.empty() && !activeTaskNum)
+                idleCondition.notify_all();
+        }
+    }
+}
@@ -0,0 +1,43 @@
+/**
+ * @brief Lequel? fixed-size thread pool
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ThreadPool: runs tasks on a fixed set of worker threads, in FIFO order
+class ThreadPool
+{
+public:
+    ThreadPool(size_t threadNum = 0);
+    ~ThreadPool();
+
+    void submit(const std::function<void()> &task);
+    void wait();
+
+    size_t size() const;
+
+private:
+    void run();
+
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable taskCondition;
+    std::condition_variable idleCondition;
+    std::deque<std::function<void()>> tasks;
+    size_t activeTaskNum;
+    bool shouldStop;
+};
+
+#endif
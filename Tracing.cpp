@@ -0,0 +1,213 @@
+/**
+ * @brief Lequel? span tracing, exported as Chrome trace-event JSON
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ *
+ * @cite https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <unistd.h>
+#endif
+
+#include "Tracing.h"
+
+using namespace std;
+
+atomic<bool> tracingEnabled(false);
+
+// TraceEvent: one ring buffer slot. sequence is the index of the span it
+// holds plus 1 (0 while being written), so a reader can detect overwrites.
+struct TraceEvent
+{
+    atomic<uint64_t> sequence{0};
+    atomic<const char *> name{nullptr};
+    atomic<uint64_t> beginTime{0};
+    atomic<uint64_t> endTime{0};
+};
+
+// TraceBuffer: spans of one thread, written only by that thread
+struct TraceBuffer
+{
+    uint32_t threadId;
+    atomic<uint64_t> spanNum{0};
+    vector<TraceEvent> events;
+
+    TraceBuffer(uint32_t threadId) : threadId(threadId), events(TRACE_BUFFER_SIZE)
+    {
+    }
+};
+
+// Buffers of every thread that recorded a span. Registration locks; buffers
+// are never freed, so a dump can read them after their thread exits.
+static mutex traceBuffersMutex;
+static vector<unique_ptr<TraceBuffer>> traceBuffers;
+static thread_local TraceBuffer *threadTraceBuffer = nullptr;
+
+static const chrono::steady_clock::time_point traceEpoch = chrono::steady_clock::now();
+static string tracePath;
+
+#ifndef _WIN32
+static int traceSignalPipe[2] = {-1, -1};
+
+/**
+ * @brief Wakes the dump thread (async-signal-safe).
+ */
+static void onTraceSignal(int)
+{
+    char c = 0;
+    if (write(traceSignalPipe[1], &c, 1) < 0)
+        return;
+}
+
+/**
+ * @brief Writes the trace every time the signal arrives.
+ */
+static void runTraceSignalThread()
+{
+    char c;
+    while (read(traceSignalPipe[0], &c, 1) == 1)
+        writeTrace(tracePath);
+}
+#endif
+
+/**
+ * @brief Nanoseconds since the program started (never 0).
+ */
+uint64_t TraceSpan::getTraceTime()
+{
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - traceEpoch).count() + 1;
+}
+
+/**
+ * @brief Appends a span to the calling thread's ring buffer, without locking.
+ *
+ * @param name The span name (a string literal)
+ * @param beginTime Start time, from getTraceTime()
+ * @param endTime End time, from getTraceTime()
+ */
+void TraceSpan::recordSpan(const char *name, uint64_t beginTime, uint64_t endTime)
+{
+    if (!threadTraceBuffer)
+    {
+        lock_guard<mutex> lock(traceBuffersMutex);
+        traceBuffers.push_back(unique_ptr<TraceBuffer>(new TraceBuffer((uint32_t)traceBuffers.size() + 1)));
+        threadTraceBuffer = traceBuffers.back().get();
+    }
+
+    TraceBuffer &buffer = *threadTraceBuffer;
+    uint64_t index = buffer.spanNum.load(memory_order_relaxed);
+    TraceEvent &event = buffer.events[index % TRACE_BUFFER_SIZE];
+
+    event.sequence.store(0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    event.name.store(name, memory_order_relaxed);
+    event.beginTime.store(beginTime, memory_order_relaxed);
+    event.endTime.store(endTime, memory_order_relaxed);
+    event.sequence.store(index + 1, memory_order_release);
+
+    buffer.spanNum.store(index + 1, memory_order_release);
+}
+
+/**
+ * @brief Enables tracing.
+ *
+ * @param path Trace file written by stopTracing() and on SIGUSR1
+ * @param dumpOnSignal Whether SIGUSR1 writes the trace (POSIX only)
+ */
+void startTracing(const string &path, bool dumpOnSignal)
+{
+    tracePath = path;
+    tracingEnabled.store(true, memory_order_relaxed);
+
+#ifndef _WIN32
+    if (dumpOnSignal && (traceSignalPipe[0] < 0) && !pipe(traceSignalPipe))
+    {
+        thread(runTraceSignalThread).detach();
+        signal(SIGUSR1, onTraceSignal);
+    }
+#endif
+}
+
+/**
+ * @brief Writes the recorded spans as Chrome trace-event JSON.
+ *
+ * Can run while other threads record spans: spans overwritten during the
+ * dump are skipped.
+ *
+ * @param path Output path (viewable in Perfetto or chrome://tracing)
+ * @return true Succeeded
+ * @return false The file could not be written
+ */
+bool writeTrace(const string &path)
+{
+    ofstream file(path);
+    if (!file.is_open())
+    {
+        perror(("Error while writing trace " + path).c_str());
+        return false;
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    lock_guard<mutex> lock(traceBuffersMutex);
+    bool isFirst = true;
+    char line[256];
+    for (auto &buffer : traceBuffers)
+    {
+        snprintf(line, sizeof(line),
+                 "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                 isFirst ? "" : ",\n", buffer->threadId, buffer->threadId);
+        file << line;
+        isFirst = false;
+
+        uint64_t spanNum = buffer->spanNum.load(memory_order_acquire);
+        uint64_t firstSpan = spanNum > TRACE_BUFFER_SIZE ? spanNum - TRACE_BUFFER_SIZE : 0;
+        for (uint64_t index = firstSpan; index < spanNum; index++)
+        {
+            TraceEvent &event = buffer->events[index % TRACE_BUFFER_SIZE];
+
+            if (event.sequence.load(memory_order_acquire) != index + 1)
+                continue;
+            const char *name = event.name.load(memory_order_relaxed);
+            uint64_t beginTime = event.beginTime.load(memory_order_relaxed);
+            uint64_t endTime = event.endTime.load(memory_order_relaxed);
+            atomic_thread_fence(memory_order_acquire);
+            if (event.sequence.load(memory_order_relaxed) != index + 1)
+                continue;
+
+            snprintf(line, sizeof(line),
+                     ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                     name, buffer->threadId, beginTime / 1e3, (endTime - beginTime) / 1e3);
+            file << line;
+        }
+    }
+
+    file << "\n]}\n";
+
+    return file.good();
+}
+
+/**
+ * @brief Disables tracing and writes the trace to the startTracing() path.
+ *
+ * @return true Succeeded
+ * @return false The trace could not be written
+ */
+bool stopTracing()
+{
+    if (!tracingEnabled.exchange(false))
+        return true;
+
+    return writeTrace(tracePath);
+}
@@ -0,0 +1,53 @@
+/**
+ * @brief Lequel? span tracing, exported as Chrome trace-event JSON
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Spans kept per thread; older spans are overwritten
+const size_t TRACE_BUFFER_SIZE = 1 << 16;
+
+// Whether spans are being recorded (off by default)
+extern std::atomic<bool> tracingEnabled;
+
+// TraceSpan: records the lifetime of a scope as a span of the calling
+// thread, if tracing is enabled. The name must be a string literal.
+class TraceSpan
+{
+public:
+    TraceSpan(const char *name) : name(name),
+                                  beginTime(tracingEnabled.load(std::memory_order_relaxed) ? getTraceTime() : 0)
+    {
+    }
+
+    ~TraceSpan()
+    {
+        if (beginTime)
+            recordSpan(name, beginTime, getTraceTime());
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+    static uint64_t getTraceTime();
+    static void recordSpan(const char *name, uint64_t beginTime, uint64_t endTime);
+
+private:
+    const char *name;
+    uint64_t beginTime;
+};
+
+// Functions
+void startTracing(const std::string &path, bool dumpOnSignal = true);
+bool writeTrace(const std::string &path);
+bool stopTracing();
+
+#endif
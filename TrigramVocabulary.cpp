@@ -0,0 +1,83 @@
+/**
+ * @brief Lequel? interned trigram vocabulary
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include "MemoryAccounting.h"
+#include "TrigramVocabulary.h"
+
+using namespace std;
+
+/**
+ * @brief Returns the id of a trigram, adding it if it is new.
+ *
+ * @param trigram The trigram
+ * @return uint32_t The trigram id
+ */
+uint32_t TrigramVocabulary::intern(const string &trigram)
+{
+    auto result = ids.insert(make_pair(trigram, (uint32_t)trigrams.size()));
+    if (result.second)
+        trigrams.push_back(&result.first->first);
+
+    return result.first->second;
+}
+
+/**
+ * @brief Returns the id of a trigram.
+ *
+ * @param trigram The trigram
+ * @return uint32_t The trigram id, or NO_TRIGRAM_ID if not in the vocabulary
+ */
+uint32_t TrigramVocabulary::find(const string &trigram) const
+{
+    auto it = ids.find(trigram);
+
+    return it == ids.end() ? NO_TRIGRAM_ID : it->second;
+}
+
+/**
+ * @brief Returns the trigram with an id.
+ *
+ * @param id The trigram id
+ */
+const string &TrigramVocabulary::getTrigram(uint32_t id) const
+{
+    return *trigrams[id];
+}
+
+/**
+ * @brief Number of trigrams.
+ */
+size_t TrigramVocabulary::size() const
+{
+    return trigrams.size();
+}
+
+/**
+ * @brief Estimates the memory of the vocabulary: the hash table buckets, one
+ * heap node per trigram (next pointer, entry and cached hash), and the id
+ * index.
+ */
+size_t TrigramVocabulary::getByteSize() const
+{
+    size_t nodeSize = getHeapBlockSize(sizeof(void *) + sizeof(decltype(ids)::value_type) + sizeof(size_t));
+
+    size_t byteSize = getHeapBlockSize(ids.bucket_count() * sizeof(void *)) +
+                      getHeapBlockSize(trigrams.capacity() * sizeof(const string *));
+    for (auto &entry : ids)
+        byteSize += nodeSize + getStringHeapSize(entry.first);
+
+    return byteSize;
+}
+
+/**
+ * @brief Removes all trigrams.
+ */
+void TrigramVocabulary::clear()
+{
+    ids.clear();
+    trigrams.clear();
+}
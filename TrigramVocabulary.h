@@ -0,0 +1,44 @@
+/**
+ * @brief Lequel? interned trigram vocabulary
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#ifndef TRIGRAMVOCABULARY_H
+#define TRIGRAMVOCABULARY_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+const uint32_t NO_TRIGRAM_ID = 0xffffffff;
+
+// TrigramVocabulary: stores each distinct trigram once and numbers them
+// densely from 0, in order of first appearance
+class TrigramVocabulary
+{
+public:
+    TrigramVocabulary() = default;
+    TrigramVocabulary(TrigramVocabulary &&) = default;
+    TrigramVocabulary &operator=(TrigramVocabulary &&) = default;
+
+    // Not copyable: trigrams points into ids
+    TrigramVocabulary(const TrigramVocabulary &) = delete;
+    TrigramVocabulary &operator=(const TrigramVocabulary &) = delete;
+
+    uint32_t intern(const std::string &trigram);
+    uint32_t find(const std::string &trigram) const;
+    const std::string &getTrigram(uint32_t id) const;
+
+    size_t size() const;
+    size_t getByteSize() const;
+    void clear();
+
+private:
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<const std::string *> trigrams;
+};
+
+#endif
@@ -0,0 +1,544 @@
+/**
+ * @brief Lequel? engine benchmark
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cctype>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "BatchScoring.h"
+#include "LanguageModel.h"
+#include "LanguagesData.h"
+#include "Lequel.h"
+#include "MemoryAccounting.h"
+#include "PerfCounters.h"
+#include "SimdKernels.h"
+
+using namespace std;
+
+// Documents scored by the (slow) map-based stage
+const size_t MAP_DOCUMENT_NUM = 2000;
+
+// Scaling runs: documents per model size, and the fraction of each generated
+// profile's trigrams taken from another language at the same rank
+const size_t SCALING_DOCUMENT_NUM = 1000;
+const double SCALING_MUTATION_RATE = 0.4;
+
+// Trigrams drawn per scaling document, so its profile is long enough to
+// prune (PRUNING_MIN_TRIGRAMS)
+const size_t SCALING_TRIGRAM_NUM = 200;
+
+/**
+ * @brief Formats like printf(), for output through cout.
+ */
+static string getFormattedString(const char *format, ...)
+{
+    char buffer[256];
+
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(buffer, sizeof(buffer), format, arguments);
+    va_end(arguments);
+
+    return buffer;
+}
+
+// Hardware counters around each stage
+static PerfCounters perfCounters;
+
+/**
+ * @brief Parses a decimal count or byte size argument.
+ *
+ * @param s The argument
+ * @param value Destination value
+ * @return true Succeeded
+ * @return false Not a non-negative decimal number, or out of range
+ */
+static bool parseSize(const char *s, size_t &value)
+{
+    if (!isdigit((unsigned char)*s))
+        return false;
+
+    errno = 0;
+    char *end;
+    unsigned long long parsedValue = strtoull(s, &end, 10);
+    if (*end || (errno == ERANGE) || (parsedValue > SIZE_MAX))
+        return false;
+
+    value = (size_t)parsedValue;
+
+    return true;
+}
+
+/**
+ * @brief Runs a benchmark stage and prints its timing and hardware counters.
+ *
+ * @param name Stage name
+ * @param documentNum Documents processed by the stage
+ * @param trigramNum Text trigrams processed by the stage (per-trigram rates
+ * are skipped if 0)
+ * @param stage The stage
+ * @return double Elapsed seconds
+ */
+template <typename Function>
+static double runStage(const char *name, size_t documentNum, size_t trigramNum, Function stage)
+{
+    auto startTime = chrono::steady_clock::now();
+    perfCounters.start();
+    stage();
+    perfCounters.stop();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    cout << getFormattedString("%-24s %10.2f ms %12.0f docs/s %10.1f ns/trigram\n", name, seconds * 1e3,
+                               documentNum / seconds, trigramNum ? seconds * 1e9 / trigramNum : 0.0);
+
+    string counters;
+    if (perfCounters.isAvailable(PERF_CYCLES) && perfCounters.isAvailable(PERF_INSTRUCTIONS) &&
+        perfCounters.getValue(PERF_CYCLES))
+    {
+        counters += getFormattedString("IPC %.2f", (double)perfCounters.getValue(PERF_INSTRUCTIONS) /
+                                                       perfCounters.getValue(PERF_CYCLES));
+    }
+    for (int i = 0; trigramNum && (i < PERF_COUNTER_NUM); i++)
+    {
+        PerfCounter counter = (PerfCounter)i;
+        if (perfCounters.isAvailable(counter))
+        {
+            counters += getFormattedString("%s%s/trigram %.2f", counters.empty() ? "" : ", ",
+                                           PerfCounters::getName(counter),
+                                           (double)perfCounters.getValue(counter) / trigramNum);
+        }
+    }
+    if (!counters.empty())
+        cout << "    " << counters << "\n";
+
+    return seconds;
+}
+
+/**
+ * @brief Counts the trigrams of a document, in or out of the vocabulary.
+ */
+static size_t getTrigramNum(const string &document)
+{
+    size_t codePointNum = 0;
+    for (size_t position = 0; position < document.size();)
+    {
+        getNextUTF8(document, position);
+        codePointNum++;
+    }
+
+    return codePointNum >= 3 ? codePointNum - 2 : 0;
+}
+
+/**
+ * @brief Generates short documents from the language profiles.
+ *
+ * Each document concatenates trigrams of a random language, drawn by
+ * profile weight, like a tweet-sized text.
+ *
+ * @param model The language model
+ * @param documentNum Number of documents
+ * @param trigramsPerDocument Trigrams drawn per document
+ * @param documents Destination documents
+ * @param documentLanguages Optional destination language index of each document
+ */
+static void generateDocuments(const LanguageModel &model, size_t documentNum, size_t trigramsPerDocument,
+                              vector<string> &documents, vector<size_t> *documentLanguages = nullptr)
+{
+    mt19937 random(1);
+
+    vector<discrete_distribution<size_t>> distributions;
+    for (auto &languageProfile : model.languageProfiles)
+    {
+        vector<float> weights;
+        for (auto &entry : languageProfile)
+            weights.push_back(entry.second);
+        distributions.push_back(discrete_distribution<size_t>(weights.begin(), weights.end()));
+    }
+
+    documents.clear();
+    if (documentLanguages)
+        documentLanguages->clear();
+    for (size_t i = 0; i < documentNum; i++)
+    {
+        size_t language = random() % model.languageProfiles.size();
+        if (documentLanguages)
+            documentLanguages->push_back(language);
+        const TrigramIdProfile &languageProfile = model.languageProfiles[language];
+
+        string document;
+        for (size_t j = 0; j < trigramsPerDocument; j++)
+            document += model.vocabulary.getTrigram(languageProfile[distributions[language](random)].first);
+        documents.push_back(document);
+    }
+}
+
+/**
+ * @brief Generates a model of many synthetic languages from the real ones.
+ *
+ * The first languages are the real ones. Each further language derives from
+ * a real one: it keeps its Zipfian weights rank by rank, but takes the
+ * trigram at each rank from another random real language with probability
+ * SCALING_MUTATION_RATE, so generated languages form families of similar
+ * languages, like real ones. All trigrams come from the real vocabulary.
+ *
+ * @param seedModel The model of the real languages
+ * @param languageNum Number of languages to generate
+ * @param model Destination model, without its rows (see buildLanguageModel())
+ */
+static void generateLanguageProfiles(const LanguageModel &seedModel, size_t languageNum, LanguageModel &model)
+{
+    mt19937 random(1);
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    // Seed profiles by descending weight
+    size_t seedNum = seedModel.languageProfiles.size();
+    vector<TrigramIdProfile> rankedProfiles(seedModel.languageProfiles);
+    for (auto &rankedProfile : rankedProfiles)
+    {
+        sort(rankedProfile.begin(), rankedProfile.end(),
+             [](const pair<uint32_t, float> &a, const pair<uint32_t, float> &b)
+             { return a.second > b.second; });
+    }
+
+    // Same ids as the seed vocabulary
+    model.vocabulary.clear();
+    for (uint32_t id = 0; id < seedModel.vocabulary.size(); id++)
+        model.vocabulary.intern(seedModel.vocabulary.getTrigram(id));
+
+    model.languageCodes.clear();
+    model.languageProfiles.clear();
+    for (size_t i = 0; i < languageNum; i++)
+    {
+        size_t seed = i % seedNum;
+        const TrigramIdProfile &rankedProfile = rankedProfiles[seed];
+
+        if (i < seedNum)
+        {
+            model.languageCodes.push_back(seedModel.languageCodes[seed]);
+            model.languageProfiles.push_back(seedModel.languageProfiles[seed]);
+            continue;
+        }
+
+        model.languageCodes.push_back(seedModel.languageCodes[seed] + "~" + to_string(i / seedNum));
+        model.languageProfiles.push_back(TrigramIdProfile());
+        TrigramIdProfile &languageProfile = model.languageProfiles.back();
+
+        unordered_set<uint32_t> ids;
+        float norm = 0.0f;
+        for (size_t rank = 0; rank < rankedProfile.size(); rank++)
+        {
+            uint32_t id = rankedProfile[rank].first;
+            if (uniform(random) < SCALING_MUTATION_RATE)
+            {
+                const TrigramIdProfile &donorProfile = rankedProfiles[random() % seedNum];
+                uint32_t donorId = donorProfile[min(rank, donorProfile.size() - 1)].first;
+                if (!ids.count(donorId))
+                    id = donorId;
+            }
+            if (!ids.insert(id).second)
+                continue;
+
+            float weight = rankedProfile[rank].second;
+            languageProfile.push_back(make_pair(id, weight));
+            norm += weight * weight;
+        }
+
+        norm = sqrt(norm);
+        for (auto &entry : languageProfile)
+            entry.second /= norm;
+        sort(languageProfile.begin(), languageProfile.end());
+    }
+}
+
+/**
+ * @brief Benchmarks identification with synthetic models of growing size.
+ *
+ * For each size, prints the model build time and estimated memory, the
+ * per-document latency of exhaustive and pruned scoring, and accuracy on
+ * documents drawn from the synthetic profiles.
+ *
+ * @param seedModel The model of the real languages
+ * @param languageNums Model sizes, in languages
+ * @param documentNum Documents per model size
+ * @param trigramsPerDocument Trigrams drawn per document
+ */
+static void runScaling(const LanguageModel &seedModel, const vector<size_t> &languageNums, size_t documentNum,
+                       size_t trigramsPerDocument)
+{
+    struct ScalingResult
+    {
+        size_t languageNum;
+        double buildSeconds;
+        uint64_t modelBytes;
+        double exhaustiveSeconds;
+        double prunedSeconds;
+    };
+    vector<ScalingResult> results;
+
+    for (size_t languageNum : languageNums)
+    {
+        cout << "\n"
+             << languageNum << " languages\n";
+
+        ScalingResult result = {languageNum, 0.0, 0, 0.0, 0.0};
+
+        LanguageModel model;
+        generateLanguageProfiles(seedModel, languageNum, model);
+        auto startTime = chrono::steady_clock::now();
+        buildLanguageModel(model);
+        result.buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        result.modelBytes = getLanguageModelByteSize(model);
+
+        cout << getFormattedString("%-24s %10.2f ms %10.1f MB (weight rows %.1f MB)\n", "build model",
+                                   result.buildSeconds * 1e3, result.modelBytes / 1048576.0,
+                                   model.weights.size() * sizeof(float) / 1048576.0);
+
+        vector<string> documents;
+        vector<size_t> documentLanguages;
+        generateDocuments(model, documentNum, trigramsPerDocument, documents, &documentLanguages);
+
+        vector<TrigramIdProfile> textProfiles(documents.size());
+        size_t trigramNum = 0;
+        size_t prunableNum = 0;
+        for (size_t i = 0; i < documents.size(); i++)
+        {
+            Text text;
+            getTextFromString(documents[i], text);
+            buildTrigramIdProfile(text, model.vocabulary, textProfiles[i]);
+            trigramNum += textProfiles[i].size();
+            prunableNum += (textProfiles[i].size() >= PRUNING_MIN_TRIGRAMS);
+        }
+        if (prunableNum < documents.size())
+            cout << getFormattedString("warning: %zu of %zu profiles are shorter than %zu trigrams, so the "
+                                       "pruned stage scores them exhaustively\n",
+                                       documents.size() - prunableNum, documents.size(), PRUNING_MIN_TRIGRAMS);
+
+        vector<string> exhaustiveCodes(documents.size());
+        result.exhaustiveSeconds = runStage("score exhaustive", documents.size(), trigramNum, [&]()
+                                            {
+                                                for (size_t i = 0; i < textProfiles.size(); i++)
+                                                    exhaustiveCodes[i] = identifyLanguage(textProfiles[i], model, false); });
+
+        vector<string> prunedCodes(documents.size());
+        result.prunedSeconds = runStage("score pruned", documents.size(), trigramNum, [&]()
+                                        {
+                                            for (size_t i = 0; i < textProfiles.size(); i++)
+                                                prunedCodes[i] = identifyLanguage(textProfiles[i], model, true); });
+
+        size_t correctNum = 0;
+        size_t mismatchNum = 0;
+        for (size_t i = 0; i < documents.size(); i++)
+        {
+            correctNum += (exhaustiveCodes[i] == model.languageCodes[documentLanguages[i]]);
+            mismatchNum += (exhaustiveCodes[i] != prunedCodes[i]);
+        }
+        cout << getFormattedString("accuracy %.1f%%, %zu pruning mismatches\n",
+                                   100.0 * correctNum / documents.size(), mismatchNum);
+
+        results.push_back(result);
+    }
+
+    // Growth relative to the smallest model: 1.0x per 1.0x languages is linear
+    cout << "\n"
+         << getFormattedString("%10s %12s %12s %14s %14s\n", "languages", "build ms", "model MB", "exhaustive us",
+                               "pruned us");
+    for (auto &result : results)
+    {
+        cout << getFormattedString("%10zu %12.1f %12.1f %14.1f %14.1f\n", result.languageNum,
+                                   result.buildSeconds * 1e3, result.modelBytes / 1048576.0,
+                                   result.exhaustiveSeconds * 1e6 / documentNum,
+                                   result.prunedSeconds * 1e6 / documentNum);
+    }
+    for (size_t i = 1; i < results.size(); i++)
+    {
+        cout << getFormattedString("%zu -> %zu languages (%.1fx): model %.1fx, exhaustive %.1fx, pruned %.1fx\n",
+                                   results[0].languageNum, results[i].languageNum,
+                                   (double)results[i].languageNum / results[0].languageNum,
+                                   (double)results[i].modelBytes / results[0].modelBytes,
+                                   results[i].exhaustiveSeconds / results[0].exhaustiveSeconds,
+                                   results[i].prunedSeconds / results[0].prunedSeconds);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t documentNum = 20000;
+    size_t trigramsPerDocument = 10;
+    bool isDocumentNumSet = false;
+    bool isTrigramNumSet = false;
+    vector<size_t> scalingLanguageNums;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string argument = argv[i];
+
+        bool isValid = true;
+
+        if ((argument == "--documents") && (i + 1 < argc))
+        {
+            isValid = parseSize(argv[++i], documentNum) && documentNum;
+            isDocumentNumSet = true;
+        }
+        else if ((argument == "--trigrams") && (i + 1 < argc))
+        {
+            isValid = parseSize(argv[++i], trigramsPerDocument) && trigramsPerDocument;
+            isTrigramNumSet = true;
+        }
+        else if ((argument == "--scaling") && (i + 1 < argc))
+        {
+            stringstream languageNums(argv[++i]);
+            string languageNum;
+            while (isValid && getline(languageNums, languageNum, ','))
+            {
+                size_t value;
+                isValid = parseSize(languageNum.c_str(), value) && value;
+                scalingLanguageNums.push_back(value);
+            }
+        }
+        else
+            isValid = false;
+
+        if (!isValid)
+        {
+            cout << "Usage: benchmark [--documents N] [--trigrams N] [--scaling N,N,...]\n"
+                    "  --trigrams N       Trigrams drawn per document (default 10, or 200 with\n"
+                    "                     --scaling, enough to prune)\n"
+                    "  --scaling N,N,...  Benchmark synthetic models of N languages each (e.g.\n"
+                    "                     100,1000,10000)\n";
+            return argument == "--help" ? 0 : 1;
+        }
+    }
+
+    map<string, string> languageCodeNames;
+    LanguageProfiles languages;
+    if (!loadLanguagesData(languageCodeNames, languages))
+    {
+        cerr << "Could not load trigram data." << endl;
+        return 1;
+    }
+
+    LanguageModel model;
+    buildLanguageModel(languages, model);
+
+    cout << "SIMD: " << getSimdLevelName() << ", " << model.languageCodes.size() << " languages, "
+         << model.vocabulary.size() << " trigrams\n";
+
+    string unavailableCounters;
+    for (int i = 0; i < PERF_COUNTER_NUM; i++)
+    {
+        if (!perfCounters.isAvailable((PerfCounter)i))
+            unavailableCounters += string(unavailableCounters.empty() ? "" : ", ") +
+                                   PerfCounters::getName((PerfCounter)i);
+    }
+    if (!unavailableCounters.empty())
+        cout << "Hardware counters unavailable (no PMU, or perf_event_paranoid too high): "
+             << unavailableCounters << "\n";
+
+    if (!scalingLanguageNums.empty())
+    {
+        runScaling(model, scalingLanguageNums, isDocumentNumSet ? documentNum : SCALING_DOCUMENT_NUM,
+                   isTrigramNumSet ? trigramsPerDocument : SCALING_TRIGRAM_NUM);
+        return 0;
+    }
+
+    vector<string> documents;
+    generateDocuments(model, documentNum, trigramsPerDocument, documents);
+
+    // Profiles
+    size_t textTrigramNum = 0;
+    for (auto &document : documents)
+        textTrigramNum += getTrigramNum(document);
+
+    vector<TrigramIdProfile> textProfiles(documents.size());
+    runStage("profile", documents.size(), textTrigramNum, [&]()
+             {
+                 for (size_t i = 0; i < documents.size(); i++)
+                 {
+                     Text text;
+                     getTextFromString(documents[i], text);
+                     buildTrigramIdProfile(text, model.vocabulary, textProfiles[i]);
+                 } });
+
+    size_t trigramNum = 0;
+    for (auto &textProfile : textProfiles)
+        trigramNum += textProfile.size();
+
+    // Map-based scoring (std::map lookups, one pass per language)
+    size_t mapDocumentNum = min(documents.size(), (size_t)MAP_DOCUMENT_NUM);
+    vector<TrigramProfile> trigramProfiles(mapDocumentNum);
+    size_t mapLookupNum = 0;
+    for (size_t i = 0; i < mapDocumentNum; i++)
+    {
+        Text text;
+        getTextFromString(documents[i], text);
+        trigramProfiles[i] = buildTrigramProfile(text);
+        normalizeTrigramProfile(trigramProfiles[i]);
+        mapLookupNum += trigramProfiles[i].size() * languages.size();
+    }
+
+    runStage("score map (per lookup)", mapDocumentNum, mapLookupNum, [&]()
+             {
+                 for (auto &trigramProfile : trigramProfiles)
+                 {
+                     for (auto &language : languages)
+                         getCosineSimilarity(trigramProfile, language.trigramProfile);
+                 } });
+
+    // The same, with the Bloom filter in front of each language's map
+    resetTrigramFilterStats();
+    runStage("score map+Bloom (lookup)", mapDocumentNum, mapLookupNum, [&]()
+             {
+                 TrigramHashes textHashes;
+                 TrigramFilterStats stats = {0, 0, 0};
+                 for (auto &trigramProfile : trigramProfiles)
+                 {
+                     getTrigramHashes(trigramProfile, textHashes);
+                     for (auto &language : languages)
+                         getCosineSimilarity(trigramProfile, textHashes, language, stats);
+                 }
+                 addTrigramFilterStats(stats); });
+
+    TrigramFilterStats filterStats = getTrigramFilterStats();
+    uint64_t rejectedNum = filterStats.skippedLookups + filterStats.falsePositives;
+    cout << getFormattedString("Bloom filters: %llu lookups, %.1f%% skipped, %.2f%% false positives\n",
+                               (unsigned long long)filterStats.lookups,
+                               filterStats.lookups ? 100.0 * filterStats.skippedLookups / filterStats.lookups : 0.0,
+                               rejectedNum ? 100.0 * filterStats.falsePositives / rejectedNum : 0.0);
+
+    // Scoring
+    vector<string> languageCodes(documents.size());
+    double documentSeconds = runStage("score per document", documents.size(), trigramNum, [&]()
+                                      {
+                                          for (size_t i = 0; i < textProfiles.size(); i++)
+                                              languageCodes[i] = identifyLanguage(textProfiles[i], model, false); });
+
+    vector<string> batchLanguageCodes;
+    double batchSeconds = runStage("score batched", documents.size(), trigramNum, [&]()
+                                   { identifyLanguages(textProfiles, model, batchLanguageCodes); });
+
+    size_t mismatchNum = 0;
+    for (size_t i = 0; i < documents.size(); i++)
+        mismatchNum += (languageCodes[i] != batchLanguageCodes[i]);
+
+    cout << getFormattedString("batched speedup: %.2fx, %zu mismatches\n", documentSeconds / batchSeconds,
+                               mismatchNum);
+
+    return mismatchNum ? 1 : 0;
+}
@@ -0,0 +1,1102 @@
+/**
+ * @brief Lequel? command line tool
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2022-2023
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AllocationTracking.h"
+#include "ByteTrigramModel.h"
+#include "Hash.h"
+#include "LanguageClusters.h"
+#include "LanguageModel.h"
+#include "LanguagesData.h"
+#include "Lequel.h"
+#include "MemoryAccounting.h"
+#include "NgramProfile.h"
+#include "ResultCache.h"
+#include "Segmentation.h"
+#include "SharedModel.h"
+#include "TextSampling.h"
+#include "ThreadPool.h"
+#include "Tracing.h"
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+// Identifies a text with an n-gram model of some order
+typedef function<string(const Text &)> NgramIdentifier;
+
+// Options: how inputs are identified
+struct Options
+{
+    bool segment;
+    bool bounded;
+    bool skipNoise;
+    size_t sampleBudget;
+    bool memory;
+    ResultCache *resultCache;
+    const LanguageSet *languageSet;
+    size_t shortTextBytes;
+    const NgramModel<2> *shortTextModel;
+    bool clustered;
+    const LanguageClusters *clusters;
+    const NgramIdentifier *ngramIdentifier;
+};
+
+// Labeled files of a corpus directory: (language code, path)
+typedef vector<pair<string, string>> CorpusFiles;
+
+/**
+ * @brief Formats like printf(), for output through cout.
+ */
+static string getFormattedString(const char *format, ...)
+{
+    char buffer[256];
+
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(buffer, sizeof(buffer), format, arguments);
+    va_end(arguments);
+
+    return buffer;
+}
+
+/**
+ * @brief Parses a decimal count or byte size argument.
+ *
+ * @param s The argument
+ * @param value Destination value
+ * @return true Succeeded
+ * @return false Not a non-negative decimal number, or out of range
+ */
+static bool parseSize(const char *s, size_t &value)
+{
+    if (!isdigit((unsigned char)*s))
+        return false;
+
+    errno = 0;
+    char *end;
+    unsigned long long parsedValue = strtoull(s, &end, 10);
+    if (*end || (errno == ERANGE) || (parsedValue > SIZE_MAX))
+        return false;
+
+    value = (size_t)parsedValue;
+
+    return true;
+}
+
+/**
+ * @brief Prints usage.
+ */
+static void printUsage()
+{
+    cout << "Usage: lequel [options] [file...]\n"
+            "Identifies the language of each file (or of standard input).\n"
+            "\n"
+            "Options:\n"
+            "  --segment                 Print language spans (byte offsets) instead of one label\n"
+            "  --bounded                 Count trigrams in a fixed-size Count-Min sketch (caps memory\n"
+            "                            on high-entropy input)\n"
+            "  --languages CODE,...      Only consider these languages (e.g. spa,por,eng); plain and\n"
+            "                            --sample identification\n"
+            "  --clustered               Score the language cluster centroids first, then only the\n"
+            "                            members of the best clusters (fewer weight reads, slightly\n"
+            "                            less accurate); plain and --sample identification\n"
+            "  --short-text BYTES        Identify inputs of at most BYTES (e.g. 128) with a bigram model\n"
+            "                            derived from the trigram profiles, more accurate on short\n"
+            "                            lines; plain and --sample identification\n"
+            "  --jobs N                  Identify files on N threads\n"
+            "  --trace FILE              Record a Chrome trace-event JSON of the pipeline (written at\n"
+            "                            exit, and on SIGUSR1; viewable in Perfetto)\n"
+            "  --skip-noise              Skip HTML tags and entities, URLs, e-mail addresses and\n"
+            "                            numbers when extracting trigrams (not --segment or --eval)\n"
+            "  --memory                  Report the model memory by structure and language, and the\n"
+            "                            peak heap bytes and allocations of each input (builds with\n"
+            "                            LEQUEL_ALLOCATION_TRACKING; concurrent --jobs inputs add up)\n"
+            "  --daemon                  Load the model once, then identify the file named on each\n"
+            "                            standard input line (\".memory\" prints the memory report,\n"
+            "                            \".cache\" the result cache counters)\n"
+            "  --cache BYTES             Answer repeated texts from an LRU cache of results taking at\n"
+            "                            most about BYTES, 64 KB or more (not --segment)\n"
+            "  --shm-publish NAME        Build the model once into POSIX shared memory object NAME\n"
+            "  --shm NAME                Attach the shared memory model NAME read-only instead of\n"
+            "                            loading one (plain and --sample identification)\n"
+            "  --shm-remove NAME         Remove the shared memory model NAME\n"
+            "  --sample BYTES            Profile at most about BYTES of each input: evenly spaced\n"
+            "                            blocks of files, or a random sample of standard input lines\n"
+            "  --eval DIR                Evaluate on a labeled corpus: DIR/<code>.txt or DIR/<code>/*\n"
+            "                            (one sample per line), comparing the code point and byte models\n"
+            "  --byte-profiles DIR       Byte trigram profiles (DIR/<code>.csv) for --eval, instead of\n"
+            "                            deriving them from resources/trigrams\n"
+            "  --train ORDER CORPUS OUT  Train profiles from CORPUS/<code>.txt or CORPUS/<code>/* into\n"
+            "                            OUT/<code>.csv; ORDER is 1..5 (code point n-grams) or bytes\n"
+            "  --ngram-profiles ORDER DIR\n"
+            "                            Identify with the order ORDER profiles trained into DIR by\n"
+            "                            --train (shorter inputs still use --short-text); plain and\n"
+            "                            --sample identification\n"
+            "  --max-ngrams N            N-grams kept per language by --train (default 2000)\n"
+            "  --help                    Show this help\n";
+}
+
+/**
+ * @brief Lists the labeled files of a corpus directory.
+ *
+ * @param path Corpus directory, with <code>.txt files or <code>/ subdirectories
+ * @param files Destination list
+ * @return true Succeeded
+ * @return false The directory could not be read
+ */
+static bool listCorpusFiles(const string &path, CorpusFiles &files)
+{
+    error_code error;
+    fs::directory_iterator it(path, error);
+    if (error)
+        return false;
+
+    for (; it != fs::directory_iterator(); ++it)
+    {
+        string languageCode = it->path().stem().string();
+
+        if (it->is_directory())
+        {
+            for (auto &entry : fs::recursive_directory_iterator(it->path()))
+            {
+                if (entry.is_regular_file())
+                    files.push_back(make_pair(languageCode, entry.path().string()));
+            }
+        }
+        else if (it->is_regular_file())
+            files.push_back(make_pair(languageCode, it->path().string()));
+    }
+
+    sort(files.begin(), files.end());
+
+    return true;
+}
+
+/**
+ * @brief Reads all files of a language in a corpus as one text.
+ */
+static void getCorpusText(const CorpusFiles &files, const string &languageCode, Text &corpus)
+{
+    corpus.clear();
+    for (auto &file : files)
+    {
+        Text text;
+        if ((file.first == languageCode) && getTextFromFile(file.second, text))
+            corpus.splice(corpus.end(), text);
+    }
+}
+
+/**
+ * @brief Trains n-gram profiles of one order and writes them as CSV.
+ */
+template <int N>
+static bool trainNgramProfiles(const CorpusFiles &files, const vector<string> &languageCodes,
+                               size_t maxNgramNum, const string &outputPath)
+{
+    for (auto &languageCode : languageCodes)
+    {
+        Text corpus;
+        getCorpusText(files, languageCode, corpus);
+
+        NgramProfile<N> ngramProfile;
+        trainNgramProfile<N>(corpus, maxNgramNum, ngramProfile);
+        if (!writeNgramProfile<N>(outputPath + "/" + languageCode + ".csv", ngramProfile))
+            return false;
+
+        cout << languageCode << ": " << ngramProfile.size() << " " << N << "-grams\n";
+    }
+
+    return true;
+}
+
+/**
+ * @brief Trains profiles from a corpus directory.
+ *
+ * @param order "1".."5" or "bytes"
+ * @param corpusPath Corpus directory
+ * @param outputPath Output directory
+ * @param maxNgramNum N-grams kept per language
+ * @return int Exit code
+ */
+static int train(const string &order, const string &corpusPath, const string &outputPath, size_t maxNgramNum)
+{
+    CorpusFiles files;
+    if (!listCorpusFiles(corpusPath, files))
+    {
+        cerr << "Could not read corpus directory \"" << corpusPath << "\"." << endl;
+        return 1;
+    }
+
+    vector<string> languageCodes;
+    for (auto &file : files)
+    {
+        if (languageCodes.empty() || (languageCodes.back() != file.first))
+            languageCodes.push_back(file.first);
+    }
+
+    error_code error;
+    fs::create_directories(outputPath, error);
+
+    bool succeeded;
+    if (order == "bytes")
+    {
+        succeeded = true;
+        for (auto &languageCode : languageCodes)
+        {
+            Text corpus;
+            getCorpusText(files, languageCode, corpus);
+
+            ByteTrigramProfile byteProfile;
+            trainByteTrigramProfile(corpus, maxNgramNum, byteProfile);
+            succeeded &= writeByteTrigramProfile(outputPath + "/" + languageCode + ".csv", byteProfile);
+
+            cout << languageCode << ": " << byteProfile.size() << " byte trigrams\n";
+        }
+    }
+    else if (order == "1")
+        succeeded = trainNgramProfiles<1>(files, languageCodes, maxNgramNum, outputPath);
+    else if (order == "2")
+        succeeded = trainNgramProfiles<2>(files, languageCodes, maxNgramNum, outputPath);
+    else if (order == "3")
+        succeeded = trainNgramProfiles<3>(files, languageCodes, maxNgramNum, outputPath);
+    else if (order == "4")
+        succeeded = trainNgramProfiles<4>(files, languageCodes, maxNgramNum, outputPath);
+    else if (order == "5")
+        succeeded = trainNgramProfiles<5>(files, languageCodes, maxNgramNum, outputPath);
+    else
+    {
+        cerr << "Unknown n-gram order \"" << order << "\"." << endl;
+        return 1;
+    }
+
+    if (!succeeded)
+    {
+        cerr << "Could not write profiles to \"" << outputPath << "\"." << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Builds the byte trigram model from trained profiles.
+ *
+ * Languages without a profile are left out of the model.
+ *
+ * @param path Directory with one <code>.csv per language
+ * @param languages The code point profiles (for the language order)
+ * @param byteModel Destination model
+ * @return true Succeeded
+ * @return false No profile was found
+ */
+static bool loadByteTrigramModel(const string &path, const LanguageProfiles &languages,
+                                 ByteTrigramModel &byteModel)
+{
+    vector<string> languageCodes;
+    vector<ByteTrigramProfile> byteProfiles;
+    for (auto &language : languages)
+    {
+        ByteTrigramProfile byteProfile;
+        if (!readByteTrigramProfile(path + "/" + language.languageCode + ".csv", byteProfile))
+            continue;
+
+        normalizeByteTrigramProfile(byteProfile);
+        languageCodes.push_back(language.languageCode);
+        byteProfiles.push_back(byteProfile);
+    }
+
+    buildByteTrigramModel(languageCodes, byteProfiles, byteModel);
+
+    return !languageCodes.empty();
+}
+
+/**
+ * @brief Builds an n-gram model from trained profiles.
+ *
+ * Languages without a profile are left out of the model.
+ *
+ * @param path Directory with one <code>.csv per language, from --train
+ * @param languages The trigram profiles (for the language order)
+ * @param skipNoise Skip markup, URLs and numbers in identified texts
+ * @param ngramIdentifier Destination identifier, which owns the model
+ * @return true Succeeded
+ * @return false No profile was found
+ */
+template <int N>
+static bool loadNgramModel(const string &path, const LanguageProfiles &languages, bool skipNoise,
+                           NgramIdentifier &ngramIdentifier)
+{
+    vector<string> languageCodes;
+    vector<NgramProfile<N>> ngramProfiles;
+    for (auto &language : languages)
+    {
+        NgramProfile<N> ngramProfile;
+        if (!readNgramProfile<N>(path + "/" + language.languageCode + ".csv", ngramProfile) ||
+            ngramProfile.empty())
+            continue;
+
+        normalizeNgramProfile<N>(ngramProfile);
+        languageCodes.push_back(language.languageCode);
+        ngramProfiles.push_back(std::move(ngramProfile));
+    }
+    if (languageCodes.empty())
+        return false;
+
+    shared_ptr<NgramModel<N>> model = make_shared<NgramModel<N>>();
+    buildNgramModel<N>(languageCodes, ngramProfiles, *model);
+    ngramIdentifier = [model, skipNoise](const Text &text)
+    { return identifyLanguage<N>(text, *model, skipNoise); };
+
+    return true;
+}
+
+/**
+ * @brief Builds an n-gram model of a given order from trained profiles.
+ *
+ * @param order "1".."5"
+ * @param path Directory with one <code>.csv per language, from --train
+ * @param languages The trigram profiles (for the language order)
+ * @param skipNoise Skip markup, URLs and numbers in identified texts
+ * @param ngramIdentifier Destination identifier, which owns the model
+ * @return true Succeeded
+ * @return false Unknown order, or no profile was found
+ */
+static bool loadNgramModel(const string &order, const string &path, const LanguageProfiles &languages,
+                           bool skipNoise, NgramIdentifier &ngramIdentifier)
+{
+    if (order == "1")
+        return loadNgramModel<1>(path, languages, skipNoise, ngramIdentifier);
+    else if (order == "2")
+        return loadNgramModel<2>(path, languages, skipNoise, ngramIdentifier);
+    else if (order == "3")
+        return loadNgramModel<3>(path, languages, skipNoise, ngramIdentifier);
+    else if (order == "4")
+        return loadNgramModel<4>(path, languages, skipNoise, ngramIdentifier);
+    else if (order == "5")
+        return loadNgramModel<5>(path, languages, skipNoise, ngramIdentifier);
+
+    return false;
+}
+
+/**
+ * @brief Evaluates the code point and byte models on a labeled corpus.
+ *
+ * Every line of at least 8 bytes is one sample. Prints the accuracy of
+ * both models, and of two-stage identification by cluster, for each
+ * language, together with their throughput and the weights read by the
+ * two-stage identification.
+ *
+ * @param corpusPath Corpus directory
+ * @param languages The code point profiles
+ * @param model The code point model
+ * @param byteModel The byte model
+ * @param clusters The code point model's language clusters
+ * @return int Exit code
+ */
+static int evaluate(const string &corpusPath, const LanguageProfiles &languages,
+                    const LanguageModel &model, const ByteTrigramModel &byteModel,
+                    const LanguageClusters &clusters)
+{
+    CorpusFiles files;
+    if (!listCorpusFiles(corpusPath, files))
+    {
+        cerr << "Could not read corpus directory \"" << corpusPath << "\"." << endl;
+        return 1;
+    }
+
+    struct Score
+    {
+        size_t samples;
+        size_t codePointHits;
+        size_t byteHits;
+        size_t clusteredHits;
+    };
+    map<string, Score> scores;
+    for (auto &language : languages)
+        scores[language.languageCode] = Score{0, 0, 0, 0};
+
+    size_t byteNum = 0;
+    double codePointSeconds = 0;
+    double byteSeconds = 0;
+    double clusteredSeconds = 0;
+    uint64_t weightReads = 0;
+    uint64_t clusteredWeightReads = 0;
+
+    for (auto &file : files)
+    {
+        Text text;
+        if (!getTextFromFile(file.second, text))
+            continue;
+
+        Score &score = scores[file.first];
+        for (auto &line : text)
+        {
+            if (line.size() < 8)
+                continue;
+
+            Text sample(1, line);
+            byteNum += line.size();
+
+            auto startTime = chrono::steady_clock::now();
+            string codePointCode = identifyLanguage(sample, model);
+            auto middleTime = chrono::steady_clock::now();
+            string byteCode = identifyLanguage(sample, byteModel);
+            auto endTime = chrono::steady_clock::now();
+            string clusteredCode = identifyLanguage(sample, model, clusters, &clusteredWeightReads);
+            auto clusteredEndTime = chrono::steady_clock::now();
+
+            codePointSeconds += chrono::duration<double>(middleTime - startTime).count();
+            byteSeconds += chrono::duration<double>(endTime - middleTime).count();
+            clusteredSeconds += chrono::duration<double>(clusteredEndTime - endTime).count();
+
+            TrigramIdProfile textProfile;
+            buildTrigramIdProfile(sample, model.vocabulary, textProfile);
+            weightReads += textProfile.size() * model.languageCodes.size();
+
+            score.samples++;
+            score.codePointHits += (codePointCode == file.first);
+            score.byteHits += (byteCode == file.first);
+            score.clusteredHits += (clusteredCode == file.first);
+        }
+    }
+
+    Score total = {0, 0, 0, 0};
+    cout << getFormattedString("%-8s %8s %11s %9s %11s\n", "language", "samples", "codepoint%", "bytes%",
+                               "clustered%");
+    for (auto &entry : scores)
+    {
+        const Score &score = entry.second;
+        if (!score.samples)
+            continue;
+
+        cout << getFormattedString("%-8s %8zu %10.1f%% %8.1f%% %10.1f%%\n", entry.first.c_str(), score.samples,
+                                   100.0 * score.codePointHits / score.samples,
+                                   100.0 * score.byteHits / score.samples,
+                                   100.0 * score.clusteredHits / score.samples);
+
+        total.samples += score.samples;
+        total.codePointHits += score.codePointHits;
+        total.byteHits += score.byteHits;
+        total.clusteredHits += score.clusteredHits;
+    }
+
+    if (!total.samples)
+    {
+        cerr << "No samples in \"" << corpusPath << "\"." << endl;
+        return 1;
+    }
+
+    cout << getFormattedString("%-8s %8zu %10.1f%% %8.1f%% %10.1f%%\n", "total", total.samples,
+                               100.0 * total.codePointHits / total.samples,
+                               100.0 * total.byteHits / total.samples,
+                               100.0 * total.clusteredHits / total.samples);
+    cout << getFormattedString("throughput: codepoint %.1f MB/s, bytes %.1f MB/s, clustered %.1f MB/s\n",
+                               byteNum / codePointSeconds / 1e6, byteNum / byteSeconds / 1e6,
+                               byteNum / clusteredSeconds / 1e6);
+    cout << getFormattedString("clustered: %zu clusters, %.1f%% of the weights read by codepoint\n",
+                               clusters.members.size(), 100.0 * clusteredWeightReads / weightReads);
+    cout << "bytes: only ASCII letters are case folded; other cased letters are compared as written\n";
+
+    return 0;
+}
+
+/**
+ * @brief Reads a whole file, or standard input if path is "-".
+ *
+ * @param path Path of file to read
+ * @param s Destination string
+ * @return true Succeeded
+ * @return false The file could not be read
+ */
+static bool readInput(const string &path, string &s)
+{
+    if (path == "-")
+    {
+        s.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+        return true;
+    }
+
+    Text text;
+    if (!getTextFromFile(path, text))
+        return false;
+
+    s.clear();
+    for (auto &line : text)
+        s += line + '\n';
+
+    return true;
+}
+
+/**
+ * @brief Formats the heap use of the process since
+ * startAllocationTracking().
+ */
+static string getAllocationString()
+{
+    AllocationStats stats = getAllocationStats();
+
+    return getFormattedString("heap peak %.1f KB, %llu allocations", stats.peakBytes / 1024.0,
+                              (unsigned long long)stats.allocationNum);
+}
+
+/**
+ * @brief Prints the memory of the loaded model, by structure and by language.
+ *
+ * @param languages The language profiles
+ * @param model The language model
+ */
+static void printMemoryReport(const LanguageProfiles &languages, const LanguageModel &model)
+{
+    MemoryReport structures;
+    MemoryReport languageBytes;
+    getModelMemoryReport(languages, model, structures, languageBytes);
+
+    size_t totalBytes = 0;
+    cout << "Model memory by structure (estimated):\n";
+    for (auto &entry : structures)
+    {
+        cout << getFormattedString("  %-20s %10.1f KB\n", entry.name.c_str(), entry.bytes / 1024.0);
+        totalBytes += entry.bytes;
+    }
+    cout << getFormattedString("  %-20s %10.1f KB\n", "total", totalBytes / 1024.0);
+
+    cout << "Model memory by language (map, filter and id profile):\n";
+    for (auto &entry : languageBytes)
+        cout << getFormattedString("  %-20s %10.1f KB\n", entry.name.c_str(), entry.bytes / 1024.0);
+    cout.flush();
+}
+
+/**
+ * @brief Prints the result cache counters.
+ *
+ * @param resultCache The result cache
+ */
+static void printResultCacheStats(const ResultCache &resultCache)
+{
+    ResultCacheStats stats = resultCache.getStats();
+
+    cout << getFormattedString("Result cache: %llu hits, %llu misses (%.1f%% hit rate), %zu entries, "
+                               "%.1f KB, %llu evictions\n",
+                               (unsigned long long)stats.hitNum, (unsigned long long)stats.missNum,
+                               100.0 * stats.getHitRate(), stats.entryNum, stats.byteSize / 1024.0,
+                               (unsigned long long)stats.evictionNum);
+    cout.flush();
+}
+
+/**
+ * @brief Identifies the language of one input.
+ *
+ * @param path Path of file to read, or "-" for standard input
+ * @param options Command line options
+ * @param model The language model
+ * @param sharedModel A shared model to identify with instead, or nullptr
+ * @param languageCodeNames Language names, by code
+ * @param output Destination output lines
+ * @return true Succeeded
+ * @return false The input could not be read
+ */
+static bool identifyInput(const string &path, const Options &options, const LanguageModel &model,
+                          const SharedModel *sharedModel, const map<string, string> &languageCodeNames,
+                          string &output)
+{
+    output.clear();
+
+    if (options.memory)
+        startAllocationTracking();
+
+    if (options.segment)
+    {
+        string s;
+        if (!readInput(path, s))
+            return false;
+
+        for (auto &span : segmentLanguages(s, model))
+        {
+            output += path + '\t' + to_string(span.begin) + '\t' + to_string(span.end) + '\t' +
+                      span.languageCode + '\n';
+        }
+        if (options.memory && isAllocationTrackingEnabled())
+            output += path + '\t' + getAllocationString() + '\n';
+        return true;
+    }
+
+    TextSample sample;
+    if (options.sampleBudget)
+    {
+        bool succeeded = (path == "-") ? getSampledTextFromStream(cin, options.sampleBudget, sample)
+                                       : getSampledTextFromFile(path, options.sampleBudget, sample);
+        if (!succeeded)
+            return false;
+    }
+    else
+    {
+        string s;
+        if (!readInput(path, s))
+            return false;
+
+        getTextFromString(s, sample.text);
+        sample.sampledBytes = sample.totalBytes = s.size();
+    }
+
+    // Settings that change the result seed the text hash
+    uint64_t textHash = 0;
+    string languageCode;
+    if (options.resultCache)
+    {
+        uint64_t seed = (options.bounded ? 1 : 0) | (options.skipNoise ? 2 : 0) | (options.clusters ? 4 : 0) |
+                        (options.ngramIdentifier ? 8 : 0);
+        if (options.languageSet)
+            seed = getHash64(options.languageSet->data(), options.languageSet->size() * sizeof(uint32_t), seed);
+        if (options.shortTextModel)
+            seed = getHash64(&options.shortTextBytes, sizeof(options.shortTextBytes), seed);
+
+        textHash = getTextHash(sample.text, seed);
+    }
+
+    if (!options.resultCache || !options.resultCache->get(textHash, languageCode))
+    {
+        if (options.bounded)
+        {
+            CountMinSketch sketch;
+            buildTrigramProfile(sample.text, sketch, nullptr, options.skipNoise);
+            languageCode = identifyLanguage(sketch, model);
+        }
+        else if (sharedModel)
+            languageCode = identifyLanguage(sample.text, *sharedModel, options.skipNoise);
+        else if (options.languageSet)
+            languageCode = identifyLanguage(sample.text, model, *options.languageSet, nullptr, options.skipNoise);
+        else if (options.shortTextModel && (sample.sampledBytes <= options.shortTextBytes))
+            languageCode = identifyLanguage<2>(sample.text, *options.shortTextModel, options.skipNoise);
+        else if (options.ngramIdentifier)
+            languageCode = (*options.ngramIdentifier)(sample.text);
+        else if (options.clusters)
+            languageCode = identifyLanguage(sample.text, model, *options.clusters, nullptr, options.skipNoise);
+        else
+            languageCode = identifyLanguage(sample.text, model, nullptr, options.skipNoise);
+
+        if (options.resultCache)
+            options.resultCache->put(textHash, languageCode);
+    }
+
+    auto name = languageCodeNames.find(languageCode);
+    output = path + '\t' + languageCode + '\t' + (name != languageCodeNames.end() ? name->second : "");
+    if (options.sampleBudget)
+        output += getFormattedString("\tsampled %.2f%%", 100.0 * sample.getSampledFraction());
+    if (options.memory && isAllocationTrackingEnabled())
+        output += '\t' + getAllocationString();
+    output += '\n';
+
+    return true;
+}
+
+/**
+ * @brief Builds the model and publishes it in shared memory.
+ *
+ * @param name The shared memory object name
+ * @return int Exit code
+ */
+static int publish(const string &name)
+{
+    map<string, string> languageCodeNames;
+    LanguageProfiles languages;
+    if (!loadLanguagesData(languageCodeNames, languages))
+    {
+        cerr << "Could not load trigram data." << endl;
+        return 1;
+    }
+
+    LanguageModel model;
+    buildLanguageModel(languages, model);
+
+    if (!publishSharedModel(name, model, languageCodeNames))
+        return 1;
+
+    cout << "Published " << model.languageCodes.size() << " languages as shared memory model \"" << name
+         << "\".\n";
+
+    return 0;
+}
+
+/**
+ * @brief Identifies the language of inputs, or evaluates on a labeled corpus.
+ *
+ * @param paths Paths of files to read ("-" for standard input)
+ * @param options Command line options
+ * @param candidateCodes Language codes to restrict identification to, if not empty
+ * @param evalPath Labeled corpus to evaluate on, if not empty
+ * @param byteProfilesPath Byte trigram profiles for the evaluation, if not empty
+ * @param sharedModelName Shared memory model to attach instead of loading one, if not empty
+ * @param ngramProfiles N-gram order and directory of trained profiles to identify with, if not empty
+ * @param jobNum Number of threads
+ * @param daemon Identify the files named on standard input lines instead
+ * @return int Exit code
+ */
+static int identify(const vector<string> &paths, Options options, const vector<string> &candidateCodes,
+                    const string &evalPath, const string &byteProfilesPath, const string &sharedModelName,
+                    const vector<string> &ngramProfiles, size_t jobNum, bool daemon)
+{
+    map<string, string> languageCodeNames;
+    LanguageProfiles languages;
+    LanguageModel model;
+    LanguageSet languageSet;
+    NgramModel<2> shortTextModel;
+    NgramIdentifier ngramIdentifier;
+    LanguageClusters clusters;
+    SharedModel sharedModel = SharedModel();
+    const SharedModel *sharedModelPointer = nullptr;
+
+    if (!sharedModelName.empty())
+    {
+        // Mapped, not loaded: the model pages are shared by all attached processes
+        if (!attachSharedModel(sharedModelName, sharedModel))
+            return 1;
+        sharedModelPointer = &sharedModel;
+
+        for (uint32_t i = 0; i < sharedModel.languageNum; i++)
+            languageCodeNames[sharedModel.languages[i].code] = sharedModel.languages[i].name;
+
+        if (options.memory)
+            cout << getFormattedString("Shared model: %.1f KB mapped read-only\n", sharedModel.byteSize / 1024.0);
+    }
+    else
+    {
+        if (options.memory)
+            startAllocationTracking();
+
+        if (!loadLanguagesData(languageCodeNames, languages))
+        {
+            cerr << "Could not load trigram data." << endl;
+            return 1;
+        }
+
+        buildLanguageModel(languages, model);
+
+        // Bigrams match short texts better than trigrams, which few of their
+        // trigrams fill
+        if (options.shortTextBytes)
+        {
+            buildNgramModel<2>(languages, shortTextModel);
+            options.shortTextModel = &shortTextModel;
+        }
+
+        if (!ngramProfiles.empty())
+        {
+            if (!loadNgramModel(ngramProfiles[0], ngramProfiles[1], languages, options.skipNoise, ngramIdentifier))
+            {
+                cerr << "Could not read order " << ngramProfiles[0] << " n-gram profiles from \""
+                     << ngramProfiles[1] << "\"." << endl;
+                return 1;
+            }
+            options.ngramIdentifier = &ngramIdentifier;
+        }
+
+        if (options.clustered || !evalPath.empty())
+        {
+            buildLanguageClusters(model, clusters);
+            options.clusters = &clusters;
+        }
+
+        // Compiled once, for all inputs
+        if (!candidateCodes.empty())
+        {
+            if (!buildLanguageSet(candidateCodes, model, languageSet))
+            {
+                cerr << "Unknown language code in --languages." << endl;
+                return 1;
+            }
+            options.languageSet = &languageSet;
+        }
+
+        if (options.memory)
+        {
+            AllocationStats stats = getAllocationStats();
+            printMemoryReport(languages, model);
+            if (isAllocationTrackingEnabled())
+                cout << getFormattedString("Model heap (measured): %.1f KB held, %.1f KB peak, "
+                                           "%llu allocations\n",
+                                           stats.heldBytes / 1024.0, stats.peakBytes / 1024.0,
+                                           (unsigned long long)stats.allocationNum);
+            else
+                cout << "Model heap (measured): not counted in this build (see LEQUEL_ALLOCATION_TRACKING)\n";
+        }
+
+        if (!evalPath.empty())
+        {
+            ByteTrigramModel byteModel;
+            if (byteProfilesPath.empty())
+                buildByteTrigramModel(languages, byteModel);
+            else if (!loadByteTrigramModel(byteProfilesPath, languages, byteModel))
+            {
+                cerr << "Could not read byte trigram profiles from \"" << byteProfilesPath << "\"." << endl;
+                return 1;
+            }
+
+            return evaluate(evalPath, languages, model, byteModel, clusters);
+        }
+    }
+
+    int exitCode = 0;
+    if (daemon)
+    {
+        // One request per line, answered as soon as it is read
+        string path;
+        string output;
+        while (getline(cin, path))
+        {
+            if (path == ".memory")
+            {
+                if (sharedModelPointer)
+                    cout << getFormattedString("Shared model: %.1f KB mapped read-only\n",
+                                               sharedModel.byteSize / 1024.0);
+                else
+                    printMemoryReport(languages, model);
+            }
+            else if (path == ".cache")
+            {
+                if (options.resultCache)
+                    printResultCacheStats(*options.resultCache);
+                else
+                    cout << path << "\terror\n";
+            }
+            else if (path.empty() || (path == "-"))
+                cout << path << "\terror\n";
+            else if (identifyInput(path, options, model, sharedModelPointer, languageCodeNames, output))
+                cout << output;
+            else
+                cout << path << "\terror\n";
+            cout.flush();
+        }
+    }
+    else
+    {
+        // Inputs are identified in parallel, and printed in order
+        vector<string> outputs(paths.size());
+        vector<char> succeeded(paths.size());
+        if (jobNum > 1)
+        {
+            ThreadPool threadPool(jobNum);
+            for (size_t i = 0; i < paths.size(); i++)
+            {
+                threadPool.submit([&, i]()
+                                  { succeeded[i] = identifyInput(paths[i], options, model, sharedModelPointer,
+                                                                 languageCodeNames, outputs[i]); });
+            }
+            threadPool.wait();
+        }
+
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            if (jobNum <= 1)
+                succeeded[i] = identifyInput(paths[i], options, model, sharedModelPointer, languageCodeNames,
+                                             outputs[i]);
+
+            TraceSpan span("output");
+            cout << outputs[i];
+            cout.flush();
+            if (!succeeded[i])
+                exitCode = 1;
+        }
+
+        if (options.resultCache)
+            printResultCacheStats(*options.resultCache);
+    }
+
+    detachSharedModel(sharedModel);
+
+    return exitCode;
+}
+
+int main(int argc, char *argv[])
+{
+    // Standard input may be gigabytes long
+    ios::sync_with_stdio(false);
+
+    Options options = {false, false, false, 0, false, nullptr, nullptr, 0, nullptr, false, nullptr, nullptr};
+    vector<string> candidateCodes;
+    size_t cacheBudget = 0;
+    size_t jobNum = 1;
+    bool daemon = false;
+    string sharedModelName;
+    string publishName;
+    string removeName;
+    string tracePath;
+    string evalPath;
+    string byteProfilesPath;
+    vector<string> trainArguments;
+    vector<string> ngramProfiles;
+    size_t maxNgramNum = 2000;
+    vector<string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string argument = argv[i];
+        bool isValid = true;
+
+        if (argument == "--segment")
+            options.segment = true;
+        else if (argument == "--bounded")
+            options.bounded = true;
+        else if ((argument == "--sample") && (i + 1 < argc))
+            isValid = parseSize(argv[++i], options.sampleBudget);
+        else if (argument == "--skip-noise")
+            options.skipNoise = true;
+        else if (argument == "--memory")
+            options.memory = true;
+        else if (argument == "--daemon")
+            daemon = true;
+        else if ((argument == "--cache") && (i + 1 < argc))
+            isValid = parseSize(argv[++i], cacheBudget);
+        else if ((argument == "--languages") && (i + 1 < argc))
+        {
+            stringstream languageCodes(argv[++i]);
+            string languageCode;
+            while (getline(languageCodes, languageCode, ','))
+            {
+                if (!languageCode.empty())
+                    candidateCodes.push_back(languageCode);
+            }
+        }
+        else if (argument == "--clustered")
+            options.clustered = true;
+        else if ((argument == "--short-text") && (i + 1 < argc))
+            isValid = parseSize(argv[++i], options.shortTextBytes);
+        else if ((argument == "--jobs") && (i + 1 < argc))
+            isValid = parseSize(argv[++i], jobNum);
+        else if ((argument == "--trace") && (i + 1 < argc))
+            tracePath = argv[++i];
+        else if ((argument == "--shm") && (i + 1 < argc))
+            sharedModelName = argv[++i];
+        else if ((argument == "--shm-publish") && (i + 1 < argc))
+            publishName = argv[++i];
+        else if ((argument == "--shm-remove") && (i + 1 < argc))
+            removeName = argv[++i];
+        else if ((argument == "--eval") && (i + 1 < argc))
+            evalPath = argv[++i];
+        else if ((argument == "--byte-profiles") && (i + 1 < argc))
+            byteProfilesPath = argv[++i];
+        else if ((argument == "--train") && (i + 3 < argc))
+        {
+            trainArguments.assign(argv + i + 1, argv + i + 4);
+            i += 3;
+        }
+        else if ((argument == "--ngram-profiles") && (i + 2 < argc))
+        {
+            ngramProfiles.assign(argv + i + 1, argv + i + 3);
+            i += 2;
+        }
+        else if ((argument == "--max-ngrams") && (i + 1 < argc))
+            isValid = parseSize(argv[++i], maxNgramNum);
+        else if (argument == "--help")
+        {
+            printUsage();
+            return 0;
+        }
+        else if ((argument.size() > 1) && (argument[0] == '-'))
+        {
+            printUsage();
+            return 1;
+        }
+        else
+            paths.push_back(argument);
+
+        if (!isValid)
+        {
+            cerr << "Invalid number for " << argument << ": \"" << argv[i] << "\"." << endl;
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (paths.empty())
+        paths.push_back("-");
+
+    if (!tracePath.empty())
+        startTracing(tracePath);
+
+    // Segments are byte offsets into the unfiltered input, and --eval compares
+    // with the byte model, which does not skip noise
+    if (options.skipNoise && (options.segment || !evalPath.empty()))
+    {
+        cerr << "--skip-noise does not support --segment or --eval." << endl;
+        return 1;
+    }
+    // The shared model only holds what plain identification needs
+    if (!sharedModelName.empty() && (options.segment || options.bounded || !evalPath.empty()))
+    {
+        cerr << "--shm does not support --segment, --bounded or --eval." << endl;
+        return 1;
+    }
+    if (!candidateCodes.empty() &&
+        (options.segment || options.bounded || !evalPath.empty() || !sharedModelName.empty()))
+    {
+        cerr << "--languages does not support --segment, --bounded, --eval or --shm." << endl;
+        return 1;
+    }
+    if (options.shortTextBytes &&
+        (options.segment || options.bounded || !evalPath.empty() || !sharedModelName.empty() ||
+         !candidateCodes.empty()))
+    {
+        cerr << "--short-text does not support --segment, --bounded, --eval, --shm or --languages." << endl;
+        return 1;
+    }
+    if (options.clustered &&
+        (options.segment || options.bounded || !sharedModelName.empty() || !candidateCodes.empty()))
+    {
+        cerr << "--clustered does not support --segment, --bounded, --shm or --languages." << endl;
+        return 1;
+    }
+    if (!ngramProfiles.empty() &&
+        (options.segment || options.bounded || !evalPath.empty() || !sharedModelName.empty() ||
+         !candidateCodes.empty() || options.clustered))
+    {
+        cerr << "--ngram-profiles does not support --segment, --bounded, --eval, --shm, --languages or "
+                "--clustered."
+             << endl;
+        return 1;
+    }
+
+    unique_ptr<ResultCache> resultCache;
+    if (cacheBudget)
+    {
+        resultCache.reset(new ResultCache(cacheBudget));
+        options.resultCache = resultCache.get();
+    }
+
+    int exitCode = 0;
+    if (!trainArguments.empty())
+        exitCode = train(trainArguments[0], trainArguments[1], trainArguments[2], maxNgramNum);
+    else if (!publishName.empty())
+        exitCode = publish(publishName);
+    else if (!removeName.empty())
+        exitCode = removeSharedModel(removeName) ? 0 : 1;
+    else
+        exitCode = identify(paths, options, candidateCodes, evalPath, byteProfilesPath, sharedModelName,
+                            ngramProfiles, jobNum, daemon);
+
+    if (!tracePath.empty() && !stopTracing())
+        exitCode = 1;
+
+    return exitCode;
+}
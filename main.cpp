@@ -5,74 +5,60 @@
  * @copyright Copyright (c) 2022-2023
  */
 
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "raylib.h"
 
-#include "CSVData.h"
+#include "BatchIdentification.h"
+#include "IdentificationWorker.h"
+#include "IncrementalProfile.h"
+#include "LanguageModel.h"
+#include "LanguagesData.h"
 #include "Lequel.h"
 
 using namespace std;
 
-const string LANGUAGECODE_NAMES_FILE = "resources/languagecode_names_es.csv";
-const string TRIGRAMS_PATH = "resources/trigrams/";
-
 /**
- * @brief Loads trigram data.
- * 
- * @param languageCodeNames Map of language code vs. language name (in i18n locale).
- * @param languages The trigram profiles.
- * @return true Succeeded
- * @return false Failed
+ * @brief Gets the end of the last line of a text that fits in a width.
+ *
+ * The cut point is found by binary search over code point boundaries, as
+ * dropping code points from the start never widens the rest.
+ *
+ * @param text The text, encoded as UTF-8
+ * @param fontSize The font size
+ * @param maxWidth The width available, in pixels
+ * @return string The visible end of the last line
  */
-bool loadLanguagesData(map<string, string> &languageCodeNames, LanguageProfiles &languages)
+static string getVisibleLineEnd(const string &text, int fontSize, int maxWidth)
 {
-    // Reads available language codes
-    cout << "Reading language codes..." << endl;
-
-    CSVData languageCodesCSVData;
-    if (!readCSV(LANGUAGECODE_NAMES_FILE, languageCodesCSVData))
-        return false;
+    size_t lineStart = text.rfind('\n');
+    string line = text.substr(lineStart == string::npos ? 0 : lineStart + 1);
 
-    // Reads trigram profile for each language code
-    for (auto &fields : languageCodesCSVData)
+    // Code point boundaries
+    vector<size_t> starts;
+    for (size_t i = 0; i < line.size(); i++)
     {
-        if (fields.size() != 2)
-            continue;
-
-        string languageCode = fields[0];
-        string languageName = fields[1];
-
-        languageCodeNames[languageCode] = languageName;
-
-        cout << "Reading trigram profile for language code \"" << languageCode << "\"..." << endl;
-
-        CSVData languageCSVData;
-        if (!readCSV(TRIGRAMS_PATH + languageCode + ".csv", languageCSVData))
-            return false;
-
-        languages.push_back(LanguageProfile());
-        LanguageProfile &language = languages.back();
-
-        language.languageCode = languageCode;
-
-        for (auto &fields : languageCSVData)
-        {
-            if (fields.size() != 2)
-                continue;
-
-            string trigram = fields[0];
-            float frequency = (float)stoi(fields[1]);
-
-            language.trigramProfile[trigram] = frequency;
-        }
+        if ((line[i] & 0xc0) != 0x80)
+            starts.push_back(i);
+    }
 
-        normalizeTrigramProfile(language.trigramProfile);
+    // First boundary whose rest fits
+    size_t low = 0;
+    size_t high = starts.size();
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (MeasureText(line.c_str() + starts[middle], fontSize) > maxWidth)
+            low = middle + 1;
+        else
+            high = middle;
     }
 
-    return true;
+    return low < starts.size() ? line.substr(starts[low]) : "";
 }
 
 int main(int, char *[])
@@ -80,14 +66,19 @@ int main(int, char *[])
     map<string, string> languageCodeNames;
     LanguageProfiles languages;
 
-    if (!loadLanguagesData(languageCodeNames, languages))
+    ThreadPool threadPool;
+
+    if (!loadLanguagesData(languageCodeNames, languages, &threadPool))
     {
         cout << "Could not load trigram data." << endl;
         return 1;
     }
 
+    LanguageModel model;
+    buildLanguageModel(languages, model);
+
     int screenWidth = 800;
-    int screenHeight = 450;
+    int screenHeight = 600;
 
     InitWindow(screenWidth, screenHeight, "Lequel?");
 
@@ -95,6 +86,15 @@ int main(int, char *[])
 
     string languageCode = "---";
 
+    IdentificationWorker worker(model);
+    IncrementalProfile typedText(model);
+
+    BatchIdentification batch(model, threadPool);
+    float batchScroll = 0;
+
+    // Visible end of the typed text, updated when the text changes
+    string typedString;
+
     while (!WindowShouldClose())
     {
         if (IsKeyPressed(KEY_V) &&
@@ -105,33 +105,76 @@ int main(int, char *[])
         {
             const char *clipboard = GetClipboardText();
 
-            Text text;
-            getTextFromString(clipboard, text);
-
-            languageCode = identifyLanguage(text, languages);
+            if (clipboard)
+                worker.identifyString(clipboard);
         }
 
         if (IsFileDropped())
         {
             FilePathList droppedFiles = LoadDroppedFiles();
 
-            if (droppedFiles.count == 1)
+            // Expands folders to the files they contain
+            vector<string> paths;
+            for (unsigned int i = 0; i < droppedFiles.count; i++)
             {
-                Text text;
-                getTextFromFile(droppedFiles.paths[0], text);
+                if (DirectoryExists(droppedFiles.paths[i]))
+                {
+                    FilePathList directoryFiles = LoadDirectoryFilesEx(droppedFiles.paths[i], NULL, true);
+                    for (unsigned int j = 0; j < directoryFiles.count; j++)
+                        paths.push_back(directoryFiles.paths[j]);
+                    UnloadDirectoryFiles(directoryFiles);
+                }
+                else
+                    paths.push_back(droppedFiles.paths[i]);
+            }
 
-                languageCode = identifyLanguage(text, languages);
+            bool isSingleFile = (droppedFiles.count == 1) && (paths.size() == 1);
+            UnloadDroppedFiles(droppedFiles);
 
-                UnloadDroppedFiles(droppedFiles);
+            if (isSingleFile)
+            {
+                batch.clear();
+                worker.identifyFile(paths[0]);
+            }
+            else if (paths.size())
+            {
+                batch.identifyFiles(paths);
+                batchScroll = 0;
             }
         }
 
+        worker.pollResult(languageCode);
+
+        // Live identification of typed text
+        bool isTextEdited = false;
+        int c;
+        while ((c = GetCharPressed()) != 0)
+        {
+            typedText.insert(typedText.size(), (char32_t)c);
+            isTextEdited = true;
+        }
+        if (IsKeyPressed(KEY_ENTER))
+        {
+            typedText.insert(typedText.size(), '\n');
+            isTextEdited = true;
+        }
+        if (IsKeyPressed(KEY_BACKSPACE) && typedText.size())
+        {
+            typedText.erase(typedText.size() - 1);
+            isTextEdited = true;
+        }
+        if (isTextEdited)
+        {
+            languageCode = typedText.size() ? typedText.identifyLanguage() : "---";
+            typedString = getVisibleLineEnd(typedText.getText(), 20, screenWidth - 2 * 90);
+        }
+
         BeginDrawing();
 
         ClearBackground(BEIGE);
 
         DrawText("Lequel?", 80, 80, 128, BROWN);
-        DrawText("Copia y pega con Ctrl+V, o arrastra un archivo...", 80, 220, 24, BROWN);
+        DrawText("Pega con Ctrl+V, arrastra un archivo o escribe...", 80, 220, 24, BROWN);
 
         string languageString;
         if (languageCode != "---")
@@ -142,8 +185,71 @@ int main(int, char *[])
                 languageString = "Desconocido";
         }
 
-        int languageStringWidth = MeasureText(languageString.c_str(), 48);
-        DrawText(languageString.c_str(), (screenWidth - languageStringWidth) / 2, 315, 48, BROWN);
+        if (worker.isBusy())
+        {
+            // Progress bar
+            int barWidth = screenWidth - 2 * 80;
+            DrawRectangleLines(80, 330, barWidth, 20, BROWN);
+            DrawRectangle(80, 330, (int)(barWidth * worker.getProgress()), 20, BROWN);
+        }
+        else
+        {
+            int languageStringWidth = MeasureText(languageString.c_str(), 48);
+            DrawText(languageString.c_str(), (screenWidth - languageStringWidth) / 2, 315, 48, BROWN);
+        }
+
+        // Text entry: shows the end of the last typed line
+        DrawRectangleLines(80, 385, screenWidth - 2 * 80, 40, BROWN);
+        DrawText((typedString + "_").c_str(), 90, 395, 20, BROWN);
+
+        // Result list of a multi-file drop
+        if (batch.size())
+        {
+            const int listY = 440;
+            const int listHeight = screenHeight - listY - 20;
+            const int rowHeight = 20;
+
+            Rectangle listRect = {80, (float)listY, (float)(screenWidth - 2 * 80), (float)listHeight};
+            if (CheckCollisionPointRec(GetMousePosition(), listRect))
+                batchScroll -= GetMouseWheelMove() * rowHeight;
+
+            float maxScroll = max(0.0f, (float)batch.size() * rowHeight - (listHeight - 30));
+            if (batchScroll > maxScroll)
+                batchScroll = maxScroll;
+            if (batchScroll < 0)
+                batchScroll = 0;
+
+            string header = to_string(batch.getFinishedNum()) + "/" + to_string(batch.size()) + " archivos";
+            DrawText(header.c_str(), 80, listY, 20, BROWN);
+            DrawRectangleLines(80, listY + 25, screenWidth - 2 * 80, listHeight - 25, BROWN);
+
+            BeginScissorMode(80, listY + 26, screenWidth - 2 * 80, listHeight - 27);
+            for (size_t i = 0; i < batch.size(); i++)
+            {
+                int rowY = listY + 30 + (int)(i * rowHeight - batchScroll);
+                if ((rowY < listY) || (rowY > screenHeight))
+                    continue;
+
+                string path = batch.getPath(i);
+                size_t nameStart = path.find_last_of("/\\");
+                string fileName = path.substr(nameStart == string::npos ? 0 : nameStart + 1);
+
+                string fileLanguageCode;
+                string fileLanguageString = "...";
+                if (batch.getResult(i, fileLanguageCode))
+                {
+                    if (languageCodeNames.find(fileLanguageCode) != languageCodeNames.end())
+                        fileLanguageString = languageCodeNames[fileLanguageCode];
+                    else
+                        fileLanguageString = "Desconocido";
+                }
+
+                DrawText(fileName.c_str(), 90, rowY, 16, BROWN);
+                int fileLanguageStringWidth = MeasureText(fileLanguageString.c_str(), 16);
+                DrawText(fileLanguageString.c_str(), screenWidth - 90 - fileLanguageStringWidth, rowY, 16, BROWN);
+            }
+            EndScissorMode();
+        }
 
         EndDrawing();
     }